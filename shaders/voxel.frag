@@ -5,6 +5,9 @@ out vec4 res;
 in vec2 v_uv;
 in flat vec3 v_w_normal;
 in flat int v_tex_id;
+#ifdef VOXEL_LIGHT
+in float v_light;
+#endif
 
 layout(location=0) uniform sampler2DArray t_diffuse;
 
@@ -19,6 +22,9 @@ void main()
 //	else
 	{
 		vec3 dif = texture(t_diffuse, vec3(v_uv, v_tex_id)).xyz;
+#ifdef VOXEL_LIGHT
+		dif *= v_light;
+#endif
 		res = vec4(dif, 1);
 		//res = vec4(v_uv, 0, 1);
 	}
@@ -1,15 +1,72 @@
 #version 460 core
 
 out ivec3 g_grid_id;
+// origin of the chunk (x, z), first word of its voxels (binding 0) and of its apron (binding 2)
+out flat ivec4 g_draw;
 
+// true: the chunk of the draw is read from draws[gl_DrawID] (multi draw), false: from u_draw
+uniform bool u_indirect;
+uniform ivec4 u_draw;
+
+// One per command of the multi draw, same as u_draw
+restrict readonly layout(std430, binding=4) buffer Draws
+{
+	ivec4 draws[];
+};
+
+// The dimensions of the chunks can be given as defines (GRID_DIMS ivec3(x, y, z) and SECTION_HEIGHT), so that the index math is folded
+#ifdef GRID_DIMS
+const ivec3 grid_dims = GRID_DIMS;
+const int section_height = SECTION_HEIGHT;
+#else
 uniform ivec3 grid_dims;
+uniform int section_height;
+#endif
 
-void main()
+// Order of the voxels inside a section, BasicChunk<Layout>::LayoutType::Id (see ChunkLayout.h): 0 linear, 1 morton, 2 bricked
+#ifndef VOXEL_LAYOUT
+#define VOXEL_LAYOUT 0
+#endif
+
+// Inverse of localIndex (voxel.geom), as BasicChunk::localCoords
+ivec3 localCoords(int local)
 {
-	g_grid_id = ivec3(
-		gl_VertexID / (grid_dims.z * grid_dims.y),
-		(gl_VertexID / (grid_dims.z)) % grid_dims.y,
-		gl_VertexID % (grid_dims.z)
+	const ivec3 dims = ivec3(grid_dims.x, section_height, grid_dims.z);
+#if VOXEL_LAYOUT == 1
+	ivec3 res = ivec3(0);
+	int bit = 0;
+	for(int level = 0; (1 << level) < max(dims.x, max(dims.y, dims.z)); ++level)
+	{
+		for(int a = 0; a < 3; ++a)
+		{
+			if((1 << level) < dims[a])
+			{
+				res[a] |= ((local >> bit) & 1) << level;
+				++bit;
+			}
+		}
+	}
+	return res;
+#elif VOXEL_LAYOUT == 2
+	const ivec3 bricks = dims / 4;
+	const int brick = local / 64;
+	const int i = local % 64;
+	return ivec3(
+		(brick / (bricks.y * bricks.z)) * 4 + i / 16,
+		((brick / bricks.z) % bricks.y) * 4 + (i / 4) % 4,
+		(brick % bricks.z) * 4 + i % 4
 	);
+#else
+	return ivec3(local / (dims.y * dims.z), (local / dims.z) % dims.y, local % dims.z);
+#endif
+}
 
+void main()
+{
+	// Section major ids (see Chunk.h), so that a draw call can cover a range of sections
+	const int section_size = grid_dims.x * section_height * grid_dims.z;
+	const int section = gl_VertexID / section_size;
+	g_grid_id = localCoords(gl_VertexID % section_size) + ivec3(0, section * section_height, 0);
+	// gl_DrawID is only visible to the vertex shader
+	g_draw = u_indirect ? draws[gl_DrawID] : u_draw;
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#version 460 core
+
+// Vertex pulling of the faces built by the FaceBuilder (see FaceStream.h)
+// One instance per face, 4 vertices in a triangle strip
+// The faces of all the chunks are in the same buffer, gl_BaseInstance is the first face of the draw
+
+uniform mat4 u_V;
+uniform mat4 u_P;
+// true: the chunk of the draw is read from draws[gl_DrawID] (multi draw), false: from u_chunk
+uniform bool u_indirect;
+// origin of the chunk (xyz), 2^level for the faces of a LOD level (w, see Lod.h)
+uniform vec4 u_chunk;
+
+out vec3 v_w_pos;
+out flat vec3 v_w_normal;
+out vec2 v_uv;
+out flat int v_tex_id;
+// Light and ambient occlusion of the vertex, factor of the color
+out float v_light;
+
+restrict readonly layout(std430, binding=1) buffer Faces
+{
+	// Position, direction and texture (x), light (y)
+	uvec2 faces[];
+};
+
+// One per command of the multi draw, same as u_chunk
+restrict readonly layout(std430, binding=3) buffer Draws
+{
+	vec4 draws[];
+};
+
+// Corners of the strip, in (u, v)
+const ivec2 corners[4] = ivec2[4](
+	ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1)
+);
+
+vec3 axisFromId(int id)
+{
+	vec3 res = vec3(0);
+	res[id] = 1;
+	return res;
+}
+
+void main()
+{
+	const vec4 chunk = u_indirect ? draws[gl_DrawID] : u_chunk;
+	const uvec2 record = faces[gl_BaseInstance + gl_InstanceID];
+	const uint f = record.x;
+	const ivec3 base = ivec3(f & 31u, (f >> 5) & 255u, (f >> 13) & 31u);
+	const int face = int((f >> 18) & 7u);
+	const int tex = int(f >> 21);
+
+	const int axis = face / 2;
+	const int s = face % 2;
+	const int u_axis = (axis + 1) % 3;
+	const int v_axis = (axis + 2) % 3;
+
+	// Reverse the winding of the - faces so that they are front facing from the outside
+	ivec2 corner = corners[gl_VertexID];
+	if(s == 1)
+		corner = corner.yx;
+	const vec2 uv = vec2(corner);
+
+	vec3 pos = vec3(base);
+	pos[axis] += (s == 0) ? 1 : 0;
+	pos[u_axis] += uv.x;
+	pos[v_axis] += uv.y;
+
+	// Keep the textures upright on the side faces
+	if(axis == 0)
+		v_uv = vec2(uv.y, 1 - uv.x);
+	else if(axis == 1)
+		v_uv = uv;
+	else
+		v_uv = vec2(uv.x, 1 - uv.y);
+
+	v_w_pos = chunk.xyz + pos * chunk.w;
+	v_w_normal = (s == 0 ? 1 : -1) * axisFromId(axis);
+	v_tex_id = tex;
+
+	// Brightest of the sky and block light, a step less is 20% darker, and the occlusion of the corner
+	const uint light = max(record.y & 15u, (record.y >> 4) & 15u);
+	const uint ao = (record.y >> (8 + 2 * (int(uv.x) + 2 * int(uv.y)))) & 3u;
+	v_light = (0.05 + 0.95 * pow(0.8, 15.0 - float(light))) * (0.55 + 0.15 * float(ao));
+	gl_Position = u_P * u_V * vec4(v_w_pos, 1);
+}
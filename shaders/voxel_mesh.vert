@@ -0,0 +1,82 @@
+#version 460 core
+
+// Vertex pulling of the quads built by the GreedyMesher (see Mesher.h)
+
+uniform mat4 u_M;
+uniform mat4 u_V;
+uniform mat4 u_P;
+
+out vec3 v_w_pos;
+out flat vec3 v_w_normal;
+out vec2 v_uv;
+out flat int v_tex_id;
+
+#define N_TYPES 256
+
+struct Property
+{
+	int flags;
+	int face_ids[6];
+	int _pad;
+};
+
+layout(packed, binding=10) uniform Props
+{
+	Property properties[N_TYPES];
+};
+
+restrict readonly layout(std430, binding=1) buffer Quads
+{
+	uvec2 quads[];
+};
+
+// Corners of the 2 triangles of a quad, in (u, v)
+const ivec2 corners[6] = ivec2[6](
+	ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+	ivec2(0, 0), ivec2(1, 1), ivec2(0, 1)
+);
+
+vec3 axisFromId(int id)
+{
+	vec3 res = vec3(0);
+	res[id] = 1;
+	return res;
+}
+
+void main()
+{
+	const uvec2 quad = quads[gl_VertexID / 6];
+	const ivec3 base = ivec3(quad.x & 63u, (quad.x >> 6) & 511u, (quad.x >> 15) & 63u);
+	const int face = int((quad.x >> 21) & 7u);
+	const ivec2 size = ivec2(quad.y & 511u, (quad.y >> 9) & 511u);
+	const int id = int((quad.y >> 18) & 255u);
+
+	const int axis = face / 2;
+	const int s = face % 2;
+	const int u_axis = (axis + 1) % 3;
+	const int v_axis = (axis + 2) % 3;
+
+	// Reverse the winding of the - faces so that they are front facing from the outside
+	ivec2 corner = corners[gl_VertexID % 6];
+	if(s == 1)
+		corner = corner.yx;
+	const vec2 uv = vec2(corner * size);
+
+	vec3 pos = vec3(base);
+	pos[axis] += (s == 0) ? 1 : 0;
+	pos[u_axis] += uv.x;
+	pos[v_axis] += uv.y;
+
+	// The textures repeat over the merged quads, keep them upright on the side faces
+	if(axis == 0)
+		v_uv = vec2(uv.y, size.x - uv.x);
+	else if(axis == 1)
+		v_uv = uv;
+	else
+		v_uv = vec2(uv.x, size.y - uv.y);
+
+	v_w_pos = (u_M * vec4(pos, 1)).xyz;
+	v_w_normal = (s == 0 ? 1 : -1) * axisFromId(axis);
+	v_tex_id = properties[id].face_ids[face];
+	gl_Position = u_P * u_V * vec4(v_w_pos, 1);
+}
@@ -5,6 +5,7 @@
 #include <string>
 #include <type_traits>
 #include <numeric>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -32,6 +33,7 @@
 #include <lib/Texture.h>
 
 #include <voxels/World.h>
+#include <voxels/Benchmark.h>
 
 void processInput(GLFWwindow* window, glm::vec3& moving, float& fov, float& speed)
 {
@@ -92,14 +94,285 @@ MessageCallback(GLenum source,
 		type, severity, message);
 }
 
-struct Property
+const char* rendererName(World::Renderer renderer)
 {
-	int32_t flag;
-	int32_t face_ids[6];
-	int32_t _pad;
+	if (renderer == World::Renderer::Mesh)
+		return "greedy mesh";
+	if (renderer == World::Renderer::Faces)
+		return "instanced faces";
+	return "geometry shader";
+}
+
+void printRenderStats(World const& world)
+{
+	const World::RenderStats& stats = world.renderStats();
+	std::cout << "Renderer: " << rendererName(stats.renderer) << ", " << stats.chunks << " chunks, " << stats.primitives << " triangles, " << stats.gpu_ms << "ms GPU";
+	std::cout << ", " << stats.cpu_ms << "ms CPU to submit " << stats.draw_calls << " draws (" << (world.multiDraw() ? "multi draws" : "per chunk") << ")";
+	if (stats.renderer == World::Renderer::GeometryShader)
+		std::cout << ", " << stats.sections << " sections";
+	if (stats.renderer == World::Renderer::Faces)
+		std::cout << ", " << stats.faces << " faces";
+	std::cout << ", " << stats.lod_chunks << " chunks in LOD";
+	std::cout << ", meshing: " << world.meanMeshingMs() << "ms per chunk, lighting: " << world.meanLightingMs() << "ms per chunk, faces: " << world.meanFaceBuildingMs() << "ms per chunk" << std::endl;
+	const size_t seam_faces = world.seamFacesRemoved();
+	std::cout << "Faces culled across the chunk borders: " << seam_faces << " (" << (world.loadedChunks() ? seam_faces / world.loadedChunks() : 0) << " per chunk)" << std::endl;
+	const World::CullStats& cull = world.cullStats();
+	std::cout << "Frustum culling " << (world.frustumCulling() ? "on" : "off") << ": " << cull.culled << " / " << cull.candidates << " chunks culled" << std::endl;
+	std::cout << "Cave culling " << (world.caveCulling() ? "on" : "off") << ": " << cull.cave_culled << " more chunks culled" << std::endl;
+	std::cout << "Horizon culling " << (world.horizonCulling() ? "on" : "off") << ": " << cull.horizon_culled << " more chunks culled" << std::endl;
+}
+
+// Detects the press of a key (true only on the first frame it is down)
+struct KeyPress
+{
+	int key;
+	bool down = false;
+
+	bool operator()(GLFWwindow* window)
+	{
+		const bool was_down = down;
+		down = glfwGetKey(window, key) == GLFW_PRESS;
+		return down && !was_down;
+	}
+};
+
+void printChunkMemory(World const& world)
+{
+	std::cout << "\t" << world.loadedChunks() << " chunks loaded: " << (world.chunksHostMemory() >> 20) << "MiB host, " << (world.chunksDeviceMemory() >> 20) << "MiB device";
+	std::cout << " (budget " << (world.memoryBudget() >> 20) << "MiB), " << world.totalUnloadedChunks() << " unloaded, ";
+	std::cout << (world.bufferPool().freeBytes() >> 20) << "MiB of pooled buffers, ";
+	std::cout << "faces arena: " << (world.faceArena().usedBytes() >> 20) << " / " << (world.faceArena().capacity() >> 20) << "MiB in use, " << world.faceArena().freeRanges() << " free ranges, ";
+	std::cout << "voxels arena: " << (world.voxelArena().usedBytes() >> 20) << " / " << (world.voxelArena().capacity() >> 20) << "MiB in use, " << world.voxelArena().freeRanges() << " free ranges" << std::endl;
+}
+
+// Flies straight at Shift speed and reports the chunk streaming throughput and the frame time spikes
+// The long flight (Ctrl+B) also samples the memory every minute, it should stay flat
+struct FlightBenchmark
+{
+	double duration = 20;
+	double elapsed = 0;
+	bool running = false;
+
+	size_t start_chunks = 0;
+	size_t start_meshed = 0;
+	double start_meshing_ms = 0;
+	double worst_frame_time = 0;
+	double total_seams_ms = 0;
+	size_t frames = 0;
+
+	double memory_period = 60;
+	double next_memory_sample = 0;
+
+	void start(World const& world, double duration_s = 20)
+	{
+		running = true;
+		duration = duration_s;
+		elapsed = 0;
+		worst_frame_time = 0;
+		frames = 0;
+		next_memory_sample = memory_period;
+		start_chunks = world.totalGeneratedChunks();
+		start_meshed = world.totalMeshedChunks();
+		start_meshing_ms = world.totalMeshingMs();
+		total_seams_ms = 0;
+		std::cout << "Starting the flight benchmark (" << duration << "s, full resolution meshing " << (world.meshAllChunks() ? "of all the chunks" : "near the camera only") << ")" << std::endl;
+	}
+
+	// returns true while the benchmark is running
+	bool update(double dt, World const& world)
+	{
+		if (!running)	return false;
+		elapsed += dt;
+		++frames;
+		worst_frame_time = std::max(worst_frame_time, dt);
+		total_seams_ms += world.streamingStats().seams_ms;
+		if (duration > memory_period && elapsed >= next_memory_sample)
+		{
+			next_memory_sample += memory_period;
+			std::cout << "Flight benchmark, " << elapsed << "s:\n";
+			printChunkMemory(world);
+		}
+		if (elapsed >= duration)
+		{
+			running = false;
+			const size_t chunks = world.totalGeneratedChunks() - start_chunks;
+			std::cout << "Flight benchmark:\n";
+			std::cout << "\t" << chunks << " chunks in " << elapsed << "s -> " << (chunks / elapsed) << " chunks/s\n";
+			std::cout << "\tworst frame: " << (worst_frame_time * 1000.0) << "ms, mean frame: " << (elapsed * 1000.0 / frames) << "ms\n";
+			std::cout << "\t" << world.pendingChunks() << " chunks still pending\n";
+			{
+				const World::StreamingStats& streaming = world.streamingStats();
+				std::cout << "\tstreaming: " << streaming.load_queue << " chunks queued, " << streaming.generating << " generating, " << streaming.waiting_upload << " waiting for the upload budget\n";
+			}
+			std::cout << "\tvoxels: " << world.meanDiskLoadMs() << "ms per chunk from the region files (" << world.totalDiskLoads() << " chunks), " << world.meanGenerationMs() << "ms per generated chunk\n";
+			{
+				const size_t meshed = world.totalMeshedChunks() - start_meshed;
+				const double meshing_ms = world.totalMeshingMs() - start_meshing_ms;
+				std::cout << "\tfull resolution: " << world.fullResChunks() << " of " << world.loadedChunks() << " loaded chunks, " << meshed << " meshed and lit during the flight, ";
+				std::cout << meshing_ms << "ms of worker time (" << (meshing_ms / elapsed) << "ms per second), main thread: " << (total_seams_ms / frames) << "ms per frame to submit them\n";
+			}
+			printChunkMemory(world);
+			printRenderStats(world);
+		}
+		return running;
+	}
 };
 
+// Carves a ball of about 10k blocks where the camera looks (X), then reports the frame times until the edited chunks
+// and their neighbours are meshed again (the frames of the following second)
+struct ExplosionBenchmark
+{
+	static constexpr float Radius = 13.5f;
+
+	double duration = 1;
+	double elapsed = 0;
+	bool running = false;
+
+	std::vector<World::BlockEdit> edits;
+	double worst_frame_time = 0;
+	double first_frame_time = 0;
+	size_t frames = 0;
+	World::EditStats edit_stats;
+	// Of the world at the start, the lightings after edits are counted from there
+	double edit_lighting_ms = 0;
+	size_t edit_lit_chunks = 0;
+	size_t incremental_lit_chunks = 0;
+
+	void start(World& world, glm::vec3 const& center)
+	{
+		edits.clear();
+		const int r = int(std::ceil(Radius));
+		const glm::ivec3 c = glm::ivec3(glm::floor(center));
+		for (int x = -r; x <= r; ++x)
+			for (int y = -r; y <= r; ++y)
+				for (int z = -r; z <= r; ++z)
+					if (x * x + y * y + z * z <= Radius * Radius)
+						edits.push_back({ c + glm::ivec3{ x, y, z }, Voxel{ 0 } });
+		world.setBlocks(edits);
+		edit_lighting_ms = world.editLightingMs();
+		edit_lit_chunks = world.editLitChunks();
+		incremental_lit_chunks = world.incrementalLitChunks();
+		running = true;
+		elapsed = 0;
+		worst_frame_time = 0;
+		first_frame_time = -1;
+		frames = 0;
+		std::cout << "Explosion of " << edits.size() << " blocks at " << c << std::endl;
+	}
 
+	// returns true while the benchmark is running, dt is the time of the frame that just ended
+	bool update(double dt, World const& world)
+	{
+		if (!running)	return false;
+		if (first_frame_time < 0)
+		{
+			// The edits were applied by the update of the frame that just ended
+			first_frame_time = dt;
+			edit_stats = world.editStats();
+			return true;
+		}
+		elapsed += dt;
+		++frames;
+		worst_frame_time = std::max(worst_frame_time, dt);
+		if (elapsed >= duration)
+		{
+			running = false;
+			std::cout << "Explosion benchmark:\n";
+			std::cout << "\t" << edit_stats.applied << " blocks applied in " << edit_stats.apply_ms << "ms (" << edit_stats.chunks << " chunks, " << edit_stats.sections << " sections), ";
+			std::cout << edit_stats.deferred << " deferred, " << edit_stats.dropped << " dropped, " << edit_stats.neighbours << " neighbours meshed and lit again\n";
+			std::cout << "\tframe of the edits: " << (first_frame_time * 1000.0) << "ms, then worst frame: " << (worst_frame_time * 1000.0) << "ms, mean frame: " << (elapsed * 1000.0 / frames) << "ms\n";
+			std::cout << "\tmeshing: " << world.meanMeshingMs() << "ms per chunk, lighting: " << world.meanLightingMs() << "ms per chunk, faces: " << world.meanFaceBuildingMs() << "ms per chunk" << std::endl;
+			// Measured on the workers, for the lightings triggered by the edits only
+			const size_t lit = world.editLitChunks() - edit_lit_chunks;
+			std::cout << "\tlighting of the edit: " << (world.editLightingMs() - edit_lighting_ms) << "ms over the workers for " << lit << " chunks (";
+			std::cout << (world.incrementalLitChunks() - incremental_lit_chunks) << " updated from the edited cells, the others from scratch)" << std::endl;
+		}
+		return running;
+	}
+};
+
+// Renders the same view (the camera does not move) with each renderer in turn and reports their mean GPU time (C)
+struct RendererComparison
+{
+	static constexpr int Renderers = 3;
+	// Each renderer with its draws per chunk, then in a multi draw (the CPU submission before / after)
+	static constexpr int Runs = 2 * Renderers;
+	// The queries are read up to World::QueryFrames frames late, the first frames after a switch are skipped
+	static constexpr int WarmupFrames = 4;
+
+	int frames_per_renderer = 120;
+	bool running = false;
+	int current = 0;
+	int frame = 0;
+	World::Renderer previous;
+	bool previous_multi_draw;
+
+	double gpu_ms[Runs];
+	double cpu_ms[Runs];
+	size_t primitives[Runs];
+	size_t draw_calls[Runs];
+
+	static World::Renderer renderer(int i)
+	{
+		constexpr World::Renderer renderers[Renderers] = { World::Renderer::GeometryShader, World::Renderer::Mesh, World::Renderer::Faces };
+		return renderers[i];
+	}
+
+	void setRun(World& world, int run)
+	{
+		world.setRenderer(renderer(run / 2));
+		world.setMultiDraw(run % 2);
+	}
+
+	void start(World& world)
+	{
+		running = true;
+		current = 0;
+		frame = 0;
+		previous = world.renderer();
+		previous_multi_draw = world.multiDraw();
+		std::fill_n(gpu_ms, Runs, 0.0);
+		std::fill_n(cpu_ms, Runs, 0.0);
+		std::fill_n(primitives, Runs, 0);
+		std::fill_n(draw_calls, Runs, 0);
+		setRun(world, 0);
+		std::cout << "Comparing the renderers (" << frames_per_renderer << " frames each, without and with multi draw)" << std::endl;
+	}
+
+	// returns true while the comparison is running, after the draw of the frame
+	bool update(World& world)
+	{
+		if (!running)	return false;
+		if (frame >= WarmupFrames)
+		{
+			gpu_ms[current] += world.renderStats().gpu_ms;
+			cpu_ms[current] += world.renderStats().cpu_ms;
+			primitives[current] += world.renderStats().primitives;
+			draw_calls[current] += world.renderStats().draw_calls;
+		}
+		if (++frame == frames_per_renderer + WarmupFrames)
+		{
+			frame = 0;
+			if (++current == Runs)
+			{
+				running = false;
+				world.setRenderer(previous);
+				world.setMultiDraw(previous_multi_draw);
+				std::cout << "Renderers, mean per frame:\n";
+				for (int i = 0; i < Runs; ++i)
+				{
+					std::cout << "\t" << rendererName(renderer(i / 2)) << (i % 2 ? " (multi draw)" : " (per chunk)") << ": " << (gpu_ms[i] / frames_per_renderer) << "ms GPU, ";
+					std::cout << (cpu_ms[i] / frames_per_renderer) << "ms CPU submission of " << (draw_calls[i] / frames_per_renderer) << " draws, ";
+					std::cout << (primitives[i] / frames_per_renderer) << " triangles\n";
+				}
+				std::cout << std::flush;
+				return false;
+			}
+			setRun(world, current);
+		}
+		return true;
+	}
+};
 
 GLenum CHECK_GL_ERROR()
 {
@@ -129,7 +402,7 @@ std::vector<img::Image<img::io::RGBAu>> parseAtlas(img::Image<img::io::RGBAu> co
 	return res;
 }
 
-int main()
+int main(int argc, char** argv)
 {
 	using Vertex = lib::Vertex<float>;
 	using Camera = lib::Camera<float>;
@@ -168,6 +441,16 @@ int main()
 		return -1;
 	}
 
+	if (argc >= 2 && std::string(argv[1]) == "--bench")
+	{
+		if (argc >= 3)
+			main_res = bench::run(argv[2]) ? 0 : -1;
+		else
+			bench::listBenchmarks();
+		glfwTerminate();
+		return main_res;
+	}
+
 	lib::MouseHandler mouse_handler(window.get());
 
 	CHECK_GL_ERROR();
@@ -237,8 +520,24 @@ int main()
 		glBufferData(GL_UNIFORM_BUFFER, sizeof(Property) * properties.size(), properties.data(), GL_STATIC_READ);
 		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
+		world.setProperties(properties);
+		world.setSaveDirectory("../saves/world/");
+
 		CHECK_GL_ERROR();
 
+		FlightBenchmark flight_benchmark;
+		ExplosionBenchmark explosion_benchmark;
+		KeyPress explode{ GLFW_KEY_X };
+		KeyPress switch_renderer{ GLFW_KEY_M };
+		KeyPress compare_renderers{ GLFW_KEY_C };
+		RendererComparison renderer_comparison;
+		KeyPress switch_culling{ GLFW_KEY_F };
+		KeyPress switch_cave_culling{ GLFW_KEY_G };
+		KeyPress switch_multi_draw{ GLFW_KEY_I };
+		KeyPress switch_horizon_culling{ GLFW_KEY_H };
+		KeyPress switch_mesh_all{ GLFW_KEY_L };
+		KeyPress pick_block{ GLFW_KEY_P };
+
 		while (!window.shouldClose())
 		{
 			{
@@ -252,15 +551,84 @@ int main()
 			glm::vec3 zqsd;
 			float speed;
 			processInput(window.get(), zqsd, mouse_handler.fov, speed);
+			if (glfwGetKey(window.get(), GLFW_KEY_B) == GLFW_PRESS && !flight_benchmark.running)
+			{
+				const bool long_flight = glfwGetKey(window.get(), GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS;
+				flight_benchmark.start(world, long_flight ? 3600 : 20);
+			}
+			if (switch_renderer(window.get()))
+			{
+				printRenderStats(world);
+				world.setRenderer(World::Renderer((int(world.renderer()) + 1) % RendererComparison::Renderers));
+				std::cout << "Switching to the " << rendererName(world.renderer()) << " renderer" << std::endl;
+			}
+			if (compare_renderers(window.get()) && !renderer_comparison.running)
+			{
+				renderer_comparison.start(world);
+			}
+			if (pick_block(window.get()))
+			{
+				const RayHit hit = world.raycast(Ray{ camera.getPosition(), mouse_handler.direction<float>(), 256 });
+				if (hit.hit)
+					std::cout << "Block " << hit.value.id << " at " << hit.voxel << ", face " << hit.face << ", " << hit.distance << " away" << std::endl;
+				else
+					std::cout << "No block in sight" << std::endl;
+			}
+			// Before the start, dt being the time of the previous frame
+			explosion_benchmark.update(dt, world);
+			if (explode(window.get()) && !explosion_benchmark.running)
+			{
+				const RayHit hit = world.raycast(Ray{ camera.getPosition(), mouse_handler.direction<float>(), 256 });
+				if (hit.hit)
+					explosion_benchmark.start(world, glm::vec3(hit.voxel));
+				else
+					std::cout << "No block in sight" << std::endl;
+			}
+			if (switch_culling(window.get()))
+			{
+				printRenderStats(world);
+				world.setFrustumCulling(!world.frustumCulling());
+			}
+			if (switch_cave_culling(window.get()))
+			{
+				printRenderStats(world);
+				world.setCaveCulling(!world.caveCulling());
+			}
+			if (switch_horizon_culling(window.get()))
+			{
+				printRenderStats(world);
+				world.setHorizonCulling(!world.horizonCulling());
+			}
+			if (switch_multi_draw(window.get()))
+			{
+				printRenderStats(world);
+				world.setMultiDraw(!world.multiDraw());
+			}
+			if (switch_mesh_all(window.get()))
+			{
+				world.setMeshAllChunks(!world.meshAllChunks());
+				std::cout << "Full resolution meshing " << (world.meshAllChunks() ? "of all the loaded chunks" : "near the camera only") << std::endl;
+			}
+			if (flight_benchmark.update(dt, world))
+			{
+				// Shift speed, straight ahead
+				zqsd = { 0, 1, 0 };
+				speed = 4;
+			}
+			if (renderer_comparison.running)
+			{
+				zqsd = { 0, 0, 0 };
+			}
 			mouse_handler.update(dt);
 			//mouse_handler.print(std::cout);
 			{
 				const float cam_speed = 10.f * 5 * speed;
 				camera.move(zqsd * float(dt) * cam_speed);
 			}
-			camera.setDirection(mouse_handler.direction<float>());
+			if (!renderer_comparison.running)
+				camera.setDirection(mouse_handler.direction<float>());
 
-			world.update(camera.getPosition());
+			world.update(camera.getPosition(), camera.getDirection());
 			world.buildDrawList(camera);
 			
 			glClearColor(0.5, 0.5, 1.0, 1.0);
@@ -280,6 +648,7 @@ int main()
 			glBindTexture(GL_TEXTURE_2D_ARRAY, atlas_handle);
 
 			world.draw(camera);
+			renderer_comparison.update(world);
 			
 			lib::ProgramDesc::useNone();
 		}
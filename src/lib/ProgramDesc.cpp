@@ -60,7 +60,7 @@ namespace lib
 		}
 	}
 
-	bool ProgramDesc::link()
+	bool ProgramDesc::link(std::vector<std::string> const& defines)
 	{
 		m_id = glCreateProgram();
 		ShaderDesc* shaders[3] = { m_vertex_shader.get(), m_geometry_shader.get(), m_fragment_shader.get() };
@@ -69,7 +69,7 @@ namespace lib
 			if (shaders[i])
 			{
 				ShaderDesc& shader = *shaders[i];
-				if (!shader.isCompiled()) shader.compile();
+				if (!shader.isCompiled()) shader.compile(defines);
 				assert(shader.isCompiled());
 				glAttachShader(m_id, shader.id());
 			}
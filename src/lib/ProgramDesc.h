@@ -41,7 +41,8 @@ namespace lib
 
 		~ProgramDesc();
 
-		bool link();
+		// The shaders that are not compiled yet are compiled with the defines
+		bool link(std::vector<std::string> const& defines=std::vector<std::string>());
 
 		GLuint id()const;
 
@@ -116,6 +117,10 @@ namespace lib
 			{
 				glUniform3iv(u_id, 1, glm::value_ptr(value));
 			}
+			else if constexpr (std::is_same<glm::ivec4, T>::value)
+			{
+				glUniform4iv(u_id, 1, glm::value_ptr(value));
+			}
 			else
 			{
 				std::cerr << "Unrecognized uniform type " << typeid(T).name << std::endl;
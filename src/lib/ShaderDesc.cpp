@@ -76,6 +76,7 @@ namespace lib
             auto ptr_1 = std::find(code.begin(), code.end(), '#');
             auto ptr_2 = std::find(code.begin(), code.end(), '\n');
             std::string header(ptr_1, ptr_2);
+            header += "\n";
             std::fill(code.begin(), ptr_2, ' ');
             
             for (std::string const& define : defines)
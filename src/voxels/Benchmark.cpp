@@ -0,0 +1,813 @@
+#include <voxels/Benchmark.h>
+#include <voxels/ChunkMap.h>
+#include <voxels/RegionFile.h>
+#include <voxels/World.h>
+#include <voxels/Noise.h>
+#include <voxels/Raycast.h>
+#include <voxels/JobSystem.h>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+namespace bench
+{
+	namespace
+	{
+		struct Entry
+		{
+			const char* name;
+			void (*f)();
+		};
+
+		const Entry benchmarks[] = {
+			{ "chunkmap", &chunkMap },
+			{ "regions", &regions },
+			{ "noise", &noise },
+			{ "raycast", &raycast },
+			{ "layout", &layout },
+			{ "fill", &fill },
+		};
+
+		// Keeps the compiler from removing the benchmarked loops
+		volatile size_t sink;
+
+		void report(const char* what, double ms, size_t n)
+		{
+			std::cout << "\t" << std::left << std::setw(40) << what << std::right << std::setw(10) << std::fixed << std::setprecision(2) << (ms * 1e6 / double(n)) << " ns/op" << std::endl;
+		}
+	}
+
+	bool run(std::string const& name)
+	{
+		bool found = false;
+		for (Entry const& entry : benchmarks)
+		{
+			if (name == "all" || name == entry.name)
+			{
+				std::cout << "Benchmark " << entry.name << std::endl;
+				entry.f();
+				found = true;
+			}
+		}
+		if (!found)
+		{
+			std::cerr << "Unknown benchmark: " << name << std::endl;
+			listBenchmarks();
+		}
+		return found;
+	}
+
+	void listBenchmarks()
+	{
+		std::cout << "Benchmarks:";
+		for (Entry const& entry : benchmarks)
+			std::cout << " " << entry.name;
+		std::cout << " all" << std::endl;
+	}
+
+	namespace
+	{
+		// The hash World used before ChunkMap: size_t(cid.x) << 32 + size_t(cid.y), where << binds weaker than +
+		// (the shift is masked as x64 does, an unmasked shift by 64 or more is undefined)
+		struct OldChunkIdHash
+		{
+			size_t operator()(glm::ivec2 const& cid)const
+			{
+				return size_t(cid.x) << ((32 + size_t(cid.y)) & 63);
+			}
+		};
+
+		struct ChunkIdHash
+		{
+			size_t operator()(glm::ivec2 const& cid)const
+			{
+				return size_t(hashChunkId(cid));
+			}
+		};
+
+		// Fills a (2r+1)^2 square around the origin, then queries ids around it (about half misses)
+		template <class Map>
+		void benchStdMap(const char* name, int radius, std::vector<glm::ivec2> const& queries)
+		{
+			Map map;
+			const size_t n = size_t(2 * radius + 1) * size_t(2 * radius + 1);
+			std::cout << name << std::endl;
+			report("insert", timeMs([&]()
+				{
+					for (int i = -radius; i <= radius; ++i)
+						for (int j = -radius; j <= radius; ++j)
+							map[{ i, j }] = i + j;
+				}
+			), n);
+			report("lookup", timeMs([&]()
+				{
+					size_t s = 0;
+					for (glm::ivec2 const& q : queries)
+						s += map.contains(q);
+					sink = s;
+				}
+			), queries.size());
+			report("4 neighbours", timeMs([&]()
+				{
+					size_t s = 0;
+					for (auto const& [cid, v] : map)
+					{
+						for (int k = 0; k < ChunkMap<int>::NeighbourCount; ++k)
+						{
+							auto it = map.find(cid + ChunkMap<int>::neighbourOffset(k));
+							if (it != map.end())
+								s += it->second;
+						}
+					}
+					sink = s;
+				}
+			), map.size());
+			report("iterate", timeMs([&]()
+				{
+					size_t s = 0;
+					for (auto const& [cid, v] : map)
+						s += v;
+					sink = s;
+				}
+			), map.size());
+			size_t max_bucket = 0;
+			for (size_t b = 0; b < map.bucket_count(); ++b)
+				max_bucket = std::max(max_bucket, map.bucket_size(b));
+			std::cout << "\tlargest bucket: " << max_bucket << " ids" << std::endl;
+		}
+	}
+
+	void chunkMap()
+	{
+		// view distance of 32 chunks
+		const int radius = 32;
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> dist(-2 * radius, 2 * radius);
+		std::vector<glm::ivec2> queries(1 << 20);
+		for (glm::ivec2& q : queries)
+			q = { dist(rng), dist(rng) };
+
+		benchStdMap<std::unordered_map<glm::ivec2, int, OldChunkIdHash>>("std::unordered_map, previous hash", radius, queries);
+		benchStdMap<std::unordered_map<glm::ivec2, int, ChunkIdHash>>("std::unordered_map, hashChunkId", radius, queries);
+
+		ChunkMap<int> map;
+		const size_t n = size_t(2 * radius + 1) * size_t(2 * radius + 1);
+		std::cout << "ChunkMap" << std::endl;
+		report("insert", timeMs([&]()
+			{
+				for (int i = -radius; i <= radius; ++i)
+					for (int j = -radius; j <= radius; ++j)
+						map.insert({ i, j }, i + j);
+			}
+		), n);
+		report("lookup", timeMs([&]()
+			{
+				size_t s = 0;
+				for (glm::ivec2 const& q : queries)
+					s += map.contains(q);
+				sink = s;
+			}
+		), queries.size());
+		report("4 neighbours (linked)", timeMs([&]()
+			{
+				size_t s = 0;
+				map.forEach([&](ChunkHandle h, glm::ivec2, int)
+					{
+						for (int k = 0; k < ChunkMap<int>::NeighbourCount; ++k)
+						{
+							const ChunkHandle neighbour = map.neighbour(h, k);
+							if (neighbour.valid())
+								s += map[neighbour];
+						}
+					}
+				);
+				sink = s;
+			}
+		), map.size());
+		report("iterate", timeMs([&]()
+			{
+				size_t s = 0;
+				map.forEach([&](ChunkHandle, glm::ivec2, int v)
+					{
+						s += v;
+					}
+				);
+				sink = s;
+			}
+		), map.size());
+		report("erase", timeMs([&]()
+			{
+				for (int i = -radius; i <= radius; ++i)
+					for (int j = -radius; j <= radius; ++j)
+						map.erase(glm::ivec2{ i, j });
+			}
+		), n);
+	}
+}
+
+namespace bench
+{
+	void regions()
+	{
+		World world({ 32, 256, 32 }, 1);
+		const glm::ivec3 dims = { 32, 256, 32 };
+		// Crosses the borders of 4 regions
+		const int n = 16;
+		std::vector<glm::ivec2> ids;
+		for (int i = 0; i < n; ++i)
+			for (int j = 0; j < n; ++j)
+				ids.push_back(glm::ivec2{ i, j } - n / 2);
+
+		std::vector<Chunk> chunks;
+		chunks.reserve(ids.size());
+		for (size_t i = 0; i < ids.size(); ++i)
+			chunks.emplace_back(dims);
+		report("fillChunk", timeMs([&]()
+			{
+				for (size_t i = 0; i < ids.size(); ++i)
+					world.fillChunk(chunks[i], ids[i]);
+			}
+		), ids.size());
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "voxels_bench_regions";
+		std::filesystem::remove_all(directory);
+		{
+			RegionStore store(directory, dims);
+			report("save (encode + write)", timeMs([&]()
+				{
+					for (size_t i = 0; i < ids.size(); ++i)
+						store.save(ids[i], chunks[i]);
+				}
+			), ids.size());
+		}
+
+		size_t file_bytes = 0;
+		for (auto const& file : std::filesystem::directory_iterator(directory))
+			file_bytes += file.file_size();
+		std::cout << "\t" << (file_bytes / ids.size()) << " bytes per chunk on disk (header included)" << std::endl;
+
+		size_t mismatches = 0;
+		{
+			// A new store: the files are mapped again
+			RegionStore store(directory, dims);
+			Chunk chunk(dims);
+			size_t loaded = 0;
+			report("load (mmap + decode)", timeMs([&]()
+				{
+					for (size_t i = 0; i < ids.size(); ++i)
+						loaded += store.load(ids[i], chunk);
+				}
+			), ids.size());
+			mismatches += ids.size() - loaded;
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				store.load(ids[i], chunk);
+				for (size_t aid = 0; aid < chunk.size(); ++aid)
+					mismatches += !(chunk.get(aid) == chunks[i].get(aid));
+			}
+		}
+		std::cout << "\t" << mismatches << " mismatches" << std::endl;
+		std::filesystem::remove_all(directory);
+	}
+}
+
+// The noise World used before GradientNoise, kept as the reference of the noise benchmark
+namespace legacy_perlin
+{
+	/* Function to linearly interpolate between a0 and a1
+ * Weight w should be in the range [0.0, 1.0]
+ */
+	float interpolate(float a0, float a1, float w) {
+		 //// You may want clamping by inserting:
+		 // if (0.0 > w) return a0;
+		 // if (1.0 < w) return a1;
+		 //
+		//return (a1 - a0) * w + a0;
+		 // Use this cubic interpolation [[Smoothstep]] instead, for a smooth appearance:
+		//return (a1 - a0) * (3.0 - w * 2.0) * w * w + a0;
+		
+		// Use [[Smootherstep]] for an even smoother result with a second derivative equal to zero on boundaries:
+		return (a1 - a0) * ((w * (w * 6.0 - 15.0) + 10.0) * w * w * w) + a0;
+		 
+	}
+
+	/* Create random direction vector
+	 */
+	glm::vec2 randomGradient(int ix, int iy) {
+		// Random float. No precomputed gradients mean this works for any number of grid coordinates
+		float random = 2920.f * sin(ix * 21942.f + iy * 171324.f + 8912.f) * cos(ix * 23157.f * iy * 217832.f + 9758.f);
+		return glm::vec2{cos(random), sin(random) };
+	}
+
+	// Computes the dot product of the distance and gradient vectors.
+	float dotGridGradient(int ix, int iy, float x, float y) {
+		// Get gradient from integer coordinates
+		glm::vec2 gradient = randomGradient(ix, iy);
+
+		// Compute the distance vector
+		float dx = x - (float)ix;
+		float dy = y - (float)iy;
+
+		// Compute the dot-product
+		return (dx * gradient.x + dy * gradient.y);
+	}
+
+	// Compute Perlin noise at coordinates x, y
+	float perlin(float x, float y) {
+		// Determine grid cell coordinates
+		int x0 = (int)x;
+		int x1 = x0 + 1;
+		int y0 = (int)y;
+		int y1 = y0 + 1;
+
+		// Determine interpolation weights
+		// Could also use higher order polynomial/s-curve here
+		float sx = x - (float)x0;
+		float sy = y - (float)y0;
+
+		// Interpolate between grid point gradients
+		float n0, n1, ix0, ix1, value;
+
+		n0 = dotGridGradient(x0, y0, x, y);
+		n1 = dotGridGradient(x1, y0, x, y);
+		ix0 = interpolate(n0, n1, sx);
+
+		n0 = dotGridGradient(x0, y1, x, y);
+		n1 = dotGridGradient(x1, y1, x, y);
+		ix1 = interpolate(n0, n1, sx);
+
+		value = interpolate(ix0, ix1, sy);
+		return value;
+	}
+}
+
+namespace bench
+{
+	void noise()
+	{
+		const int chunks = 256;
+		const int columns = 32;
+		const float scale = World::NoiseScale;
+		const size_t n = size_t(chunks) * columns * columns;
+		std::vector<float> legacy(n), scalar(n), grid(n), simd(n);
+		const auto chunkPos = [](int c)
+		{
+			return glm::ivec2{ c % 16 - 8, c / 16 - 8 } * columns;
+		};
+
+		std::cout << "\t" << n << " columns, batched path: " << GradientNoise::instructionSet() << std::endl;
+		const auto columnsPerSecond = [&](const char* what, double ms)
+		{
+			std::cout << "\t" << std::left << std::setw(40) << what << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (double(n) / ms * 1e-3) << " M columns/s" << std::endl;
+		};
+
+		columnsPerSecond("previous perlin::perlin", timeMs([&]()
+			{
+				for (int c = 0; c < chunks; ++c)
+				{
+					const glm::ivec2 w = chunkPos(c);
+					for (int i = 0; i < columns; ++i)
+						for (int j = 0; j < columns; ++j)
+							legacy[(c * columns + i) * columns + j] = legacy_perlin::perlin((w.x + i + 0.5) * scale, (w.y + j + 0.5) * scale);
+				}
+			}
+		));
+
+		GradientNoise gradient_noise;
+		columnsPerSecond("GradientNoise::sample", timeMs([&]()
+			{
+				for (int c = 0; c < chunks; ++c)
+				{
+					const glm::ivec2 w = chunkPos(c);
+					for (int i = 0; i < columns; ++i)
+						for (int j = 0; j < columns; ++j)
+							scalar[(c * columns + i) * columns + j] = gradient_noise.sample((w.x + i + 0.5f) * scale, (w.y + j + 0.5f) * scale);
+				}
+			}
+		));
+		columnsPerSecond("GradientNoise::sampleGridScalar", timeMs([&]()
+			{
+				for (int c = 0; c < chunks; ++c)
+				{
+					const glm::ivec2 w = chunkPos(c);
+					gradient_noise.sampleGridScalar((w.x + 0.5f) * scale, (w.y + 0.5f) * scale, scale, columns, columns, grid.data() + size_t(c) * columns * columns);
+				}
+			}
+		));
+		columnsPerSecond("GradientNoise::sampleGrid", timeMs([&]()
+			{
+				for (int c = 0; c < chunks; ++c)
+				{
+					const glm::ivec2 w = chunkPos(c);
+					gradient_noise.sampleGrid((w.x + 0.5f) * scale, (w.y + 0.5f) * scale, scale, columns, columns, simd.data() + size_t(c) * columns * columns);
+				}
+			}
+		));
+
+		// The batched paths must match the scalar one, the new noise must have the range of the previous one
+		// (they can not be equal: the gradients are not hashed the same way)
+		float max_grid_error = 0;
+		for (size_t i = 0; i < n; ++i)
+			max_grid_error = std::max({ max_grid_error, std::abs(grid[i] - scalar[i]), std::abs(simd[i] - scalar[i]) });
+		std::cout << "\tmax difference of the batched paths with sample: " << std::scientific << max_grid_error << std::fixed << std::endl;
+		const auto range = [](const char* what, std::vector<float> const& values)
+		{
+			const auto [min, max] = std::minmax_element(values.begin(), values.end());
+			double mean_abs = 0;
+			for (float v : values)
+				mean_abs += std::abs(v);
+			std::cout << "\t" << what << " in [" << std::setprecision(3) << *min << ", " << *max << "], mean |value| " << (mean_abs / values.size()) << std::endl;
+		};
+		// The previous one truncated the coordinates instead of flooring them: the negative ones extrapolate the fade curve
+		std::vector<float> legacy_positive;
+		for (int c = 0; c < chunks; ++c)
+		{
+			const glm::ivec2 w = chunkPos(c);
+			if (w.x >= 0 && w.y >= 0)
+				legacy_positive.insert(legacy_positive.end(), legacy.begin() + size_t(c) * columns * columns, legacy.begin() + size_t(c + 1) * columns * columns);
+		}
+		range("previous perlin", legacy);
+		range("previous perlin, x and z >= 0", legacy_positive);
+		range("GradientNoise", scalar);
+	}
+}
+
+namespace bench
+{
+	namespace
+	{
+		// Reference: the same traversal without skipping anything, each voxel read from its palette
+		template <class Lookup>
+		RayHit plainRaycast(glm::ivec3 const& dims, Lookup const& lookup, Ray const& ray)
+		{
+			RayHit res;
+			const glm::vec3 dir = glm::normalize(ray.direction);
+			glm::ivec3 voxel = glm::ivec3(glm::floor(ray.origin));
+			glm::ivec3 step;
+			glm::vec3 t_max, t_delta;
+			for (int a = 0; a < 3; ++a)
+			{
+				step[a] = dir[a] > 0 ? 1 : (dir[a] < 0 ? -1 : 0);
+				t_delta[a] = step[a] == 0 ? std::numeric_limits<float>::infinity() : std::abs(1.0f / dir[a]);
+				t_max[a] = step[a] == 0 ? std::numeric_limits<float>::infinity() : (float(voxel[a] + (step[a] > 0 ? 1 : 0)) - ray.origin[a]) / dir[a];
+			}
+			float t = 0;
+			int axis = -1;
+			const auto floorDiv = [](int a, int b)
+			{
+				return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+			};
+			while (t <= ray.max_distance)
+			{
+				if (voxel.y >= 0 && voxel.y < dims.y)
+				{
+					const glm::ivec2 cid = { floorDiv(voxel.x, dims.x), floorDiv(voxel.z, dims.z) };
+					const auto chunk = lookup(cid);
+					if (chunk)
+					{
+						const Voxel v = (*chunk)(voxel - glm::ivec3(cid.x * dims.x, 0, cid.y * dims.z));
+						if (v.id != 0)
+						{
+							res = { true, voxel, axis < 0 ? -1 : axis * 2 + (step[axis] > 0 ? 1 : 0), t, v };
+							return res;
+						}
+					}
+				}
+				axis = t_max.x < t_max.y ? (t_max.x < t_max.z ? 0 : 2) : (t_max.y < t_max.z ? 1 : 2);
+				t = t_max[axis];
+				voxel[axis] += step[axis];
+				t_max[axis] += t_delta[axis];
+			}
+			return res;
+		}
+	}
+
+	void raycast()
+	{
+		const glm::ivec3 dims = { 32, 256, 32 };
+		World world(dims, 1);
+		const int n_chunks = 8;
+		ChunkMap<Chunk> chunks;
+		for (int i = 0; i < n_chunks; ++i)
+		{
+			for (int j = 0; j < n_chunks; ++j)
+			{
+				const glm::ivec2 cid = glm::ivec2{ i, j } - n_chunks / 2;
+				Chunk chunk(dims);
+				world.fillChunk(chunk, cid);
+				chunks.insert(cid, std::move(chunk));
+			}
+		}
+		const auto lookup = [&chunks](glm::ivec2 cid) -> Chunk const*
+		{
+			return chunks.get(cid);
+		};
+
+		// From above the terrain, towards the ground (AO / sensor like), and some grazing ones
+		const size_t n = 1 << 18;
+		const float half_extent = 0.5f * n_chunks * dims.x;
+		std::vector<Ray> rays(n);
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> u01(0, 1);
+		for (Ray& ray : rays)
+		{
+			ray.origin = { (u01(rng) * 2 - 1) * half_extent, 100 + 60 * u01(rng), (u01(rng) * 2 - 1) * half_extent };
+			const float phi = u01(rng) * 6.2831853f;
+			const float down = 0.05f + 0.95f * u01(rng);
+			ray.direction = { std::cos(phi) * (1 - down), -down, std::sin(phi) * (1 - down) };
+			ray.max_distance = 256;
+		}
+		std::vector<RayHit> plain(n), single(n), batched(n), threaded(n);
+
+		const auto raysPerSecond = [&](const char* what, double ms)
+		{
+			std::cout << "\t" << std::left << std::setw(40) << what << std::right << std::setw(10) << std::fixed << std::setprecision(2) << (double(n) / ms * 1e-3) << " M rays/s" << std::endl;
+		};
+
+		raysPerSecond("plain DDA, per voxel palette reads", timeMs([&]()
+			{
+				for (size_t i = 0; i < n; ++i)
+					plain[i] = plainRaycast(dims, lookup, rays[i]);
+			}
+		));
+		raysPerSecond("VoxelRaycaster, one by one", timeMs([&]()
+			{
+				for (size_t i = 0; i < n; ++i)
+					single[i] = VoxelRaycaster<decltype(lookup)>(dims, lookup).cast(rays[i]);
+			}
+		));
+		raysPerSecond("VoxelRaycaster, batched", timeMs([&]()
+			{
+				VoxelRaycaster<decltype(lookup)>(dims, lookup).cast(rays.data(), n, batched.data());
+			}
+		));
+		{
+			JobSystem jobs;
+			const unsigned int workers = jobs.workerCount();
+			const size_t batch = 4096;
+			const double ms = timeMs([&]()
+				{
+					for (size_t begin = 0; begin < n; begin += batch)
+					{
+						jobs.submit([&, begin]()
+							{
+								VoxelRaycaster<decltype(lookup)>(dims, lookup).cast(rays.data() + begin, std::min(batch, n - begin), threaded.data() + begin);
+							}
+						);
+					}
+					jobs.wait();
+				}
+			);
+			raysPerSecond((std::string("VoxelRaycaster, batched, ") + std::to_string(workers) + " workers").c_str(), ms);
+		}
+
+		size_t hits = 0, mismatches = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			hits += plain[i].hit;
+			for (std::vector<RayHit> const* other : { &single, &batched, &threaded })
+			{
+				RayHit const& h = (*other)[i];
+				// Not the face: a ray crossing an edge exactly can enter by either
+				mismatches += h.hit != plain[i].hit || (h.hit && (h.voxel != plain[i].voxel || std::abs(h.distance - plain[i].distance) > 1e-3f));
+			}
+		}
+		std::cout << "\t" << hits << " / " << n << " rays hit, " << mismatches << " mismatches with the plain DDA" << std::endl;
+	}
+}
+
+namespace bench
+{
+	namespace
+	{
+		template <class LayoutChunk>
+		void benchLayout(std::string const& name, std::vector<Chunk> const& sources, int n_chunks, std::vector<Ray> const& rays)
+		{
+			const glm::ivec3 dims = sources.front().dims();
+			std::cout << name << std::endl;
+
+			ChunkMap<LayoutChunk> chunks;
+			std::vector<LayoutChunk const*> all;
+			std::vector<int32_t> ids(sources.front().size());
+			std::vector<Voxel> values;
+			for (int i = 0; i < n_chunks; ++i)
+			{
+				for (int j = 0; j < n_chunks; ++j)
+				{
+					Chunk const& source = sources[size_t(i) * n_chunks + j];
+					source.decode(ids.data());
+					LayoutChunk chunk(dims);
+					values.resize(chunk.sectionSize());
+					for (int s = 0; s < chunk.sectionCount(); ++s)
+					{
+						for (int x = 0; x < dims.x; ++x)
+							for (int y = 0; y < Chunk::SectionHeight; ++y)
+								for (int z = 0; z < dims.z; ++z)
+									values[chunk.localId(x, y, z)] = { ids[(size_t(x) * dims.y + s * Chunk::SectionHeight + y) * dims.z + z] };
+						chunk.assignSection(s, values.data());
+					}
+					chunks.insert(glm::ivec2{ i, j } - n_chunks / 2, std::move(chunk));
+				}
+			}
+			for (int i = 0; i < n_chunks; ++i)
+				for (int j = 0; j < n_chunks; ++j)
+					all.push_back(chunks.get(glm::ivec2{ i, j } - n_chunks / 2));
+			const size_t voxels = size_t(n_chunks) * n_chunks * sources.front().size();
+
+			size_t faces = 0;
+			report("face culling, 6 neighbour reads", timeMs([&]()
+				{
+					for (LayoutChunk const* chunk : all)
+					{
+						for (int x = 0; x < dims.x; ++x)
+						{
+							for (int y = 0; y < dims.y; ++y)
+							{
+								for (int z = 0; z < dims.z; ++z)
+								{
+									const glm::ivec3 p = { x, y, z };
+									if ((*chunk)(p).id == 0)
+										continue;
+									for (int f = 0; f < 6; ++f)
+									{
+										glm::ivec3 q = p;
+										q[f / 2] += (f % 2 == 0) ? 1 : -1;
+										const bool in_grid = q.x >= 0 && q.x < dims.x && q.y >= 0 && q.y < dims.y && q.z >= 0 && q.z < dims.z;
+										faces += !in_grid || (*chunk)(q).id == 0;
+									}
+								}
+							}
+						}
+					}
+				}
+			), voxels);
+
+			report("decode (meshing input)", timeMs([&]()
+				{
+					for (LayoutChunk const* chunk : all)
+						chunk->decode(ids.data());
+					sink = size_t(ids[0]);
+				}
+			), voxels);
+
+			const auto lookup = [&chunks](glm::ivec2 cid) -> LayoutChunk const*
+			{
+				return chunks.get(cid);
+			};
+			size_t hits = 0;
+			report("raycast, per voxel reads (per ray)", timeMs([&]()
+				{
+					for (Ray const& ray : rays)
+						hits += plainRaycast(dims, lookup, ray).hit;
+				}
+			), rays.size());
+			std::cout << "\t" << faces << " faces, " << hits << " / " << rays.size() << " rays hit" << std::endl;
+		}
+	}
+
+	void layout()
+	{
+		const glm::ivec3 dims = { 32, 256, 32 };
+		World world(dims, 1);
+		const int n_chunks = 4;
+		std::vector<Chunk> sources;
+		sources.reserve(size_t(n_chunks) * n_chunks);
+		for (int i = 0; i < n_chunks; ++i)
+		{
+			for (int j = 0; j < n_chunks; ++j)
+			{
+				sources.emplace_back(dims);
+				world.fillChunk(sources.back(), glm::ivec2{ i, j } - n_chunks / 2);
+			}
+		}
+
+		const size_t n = 1 << 15;
+		const float half_extent = 0.5f * n_chunks * dims.x;
+		std::vector<Ray> rays(n);
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> u01(0, 1);
+		for (Ray& ray : rays)
+		{
+			ray.origin = { (u01(rng) * 2 - 1) * half_extent, 100 + 60 * u01(rng), (u01(rng) * 2 - 1) * half_extent };
+			const float phi = u01(rng) * 6.2831853f;
+			const float down = 0.05f + 0.95f * u01(rng);
+			ray.direction = { std::cos(phi) * (1 - down), -down, std::sin(phi) * (1 - down) };
+			ray.max_distance = 256;
+		}
+
+		benchLayout<BasicChunk<LinearLayout>>(LinearLayout::Name, sources, n_chunks, rays);
+		benchLayout<BasicChunk<MortonLayout>>(MortonLayout::Name, sources, n_chunks, rays);
+		benchLayout<BasicChunk<BrickedLayout>>(BrickedLayout::Name, sources, n_chunks, rays);
+		benchLayout<FixedChunk<32, 256, 32>>(std::string(LinearLayout::Name) + ", compile time 32x256x32", sources, n_chunks, rays);
+	}
+}
+
+namespace bench
+{
+	namespace
+	{
+		// The previous World::fillChunk: each voxel set through the chunk accessor, then compacted
+		void voxelByVoxelFill(World const& world, glm::ivec3 const& dims, Chunk& c, glm::ivec2 cid)
+		{
+			c.fill(Voxel{ 0 });
+			std::vector<World::ColumnInfo> columns(size_t(dims.x) * dims.z);
+			world.generateColumnInfos(cid, columns.data());
+			for (int i = 0; i < dims.x; ++i)
+			{
+				for (int j = 0; j < dims.z; ++j)
+				{
+					const World::ColumnInfo clm = columns[i * dims.z + j];
+					for (int k = 0; k < clm.dirt_start; ++k)
+						c(glm::ivec3{ i, k, j }) = Voxel{ 1 };
+					for (int k = clm.dirt_start; k < clm.dirt_start + clm.dirt_height; ++k)
+						c(glm::ivec3{ i, k, j }) = Voxel{ 2 };
+					c(glm::ivec3{ i, clm.dirt_start + clm.dirt_height, j }) = Voxel{ 3 };
+				}
+			}
+			c.compact();
+		}
+	}
+
+	void fill()
+	{
+		const glm::ivec3 dims = { 32, 256, 32 };
+		World world(dims, 1);
+		const int n = 16;
+		std::vector<glm::ivec2> ids;
+		for (int i = 0; i < n; ++i)
+			for (int j = 0; j < n; ++j)
+				ids.push_back(glm::ivec2{ i, j } - n / 2);
+
+		const auto chunkMs = [&](std::string const& what, double ms)
+		{
+			std::cout << "\t" << std::left << std::setw(40) << what << std::right << std::setw(10) << std::fixed << std::setprecision(3) << (ms / double(ids.size())) << " ms/chunk" << std::endl;
+		};
+
+		std::vector<Chunk> reference, spans, threaded;
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			reference.emplace_back(dims);
+			spans.emplace_back(dims);
+			threaded.emplace_back(dims);
+		}
+		chunkMs("voxel by voxel (previous)", timeMs([&]()
+			{
+				for (size_t i = 0; i < ids.size(); ++i)
+					voxelByVoxelFill(world, dims, reference[i], ids[i]);
+			}
+		));
+		chunkMs("fillChunk, runs", timeMs([&]()
+			{
+				for (size_t i = 0; i < ids.size(); ++i)
+					world.fillChunk(spans[i], ids[i]);
+			}
+		));
+		{
+			JobSystem jobs;
+			const double ms = timeMs([&]()
+				{
+					for (size_t i = 0; i < ids.size(); ++i)
+						jobs.submit([&, i]() { world.fillChunk(threaded[i], ids[i]); });
+					jobs.wait();
+				}
+			);
+			chunkMs("fillChunk, runs, " + std::to_string(jobs.workerCount()) + " workers", ms);
+		}
+
+		size_t mismatches = 0;
+		std::vector<int32_t> a(reference.front().size()), b(a.size());
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			reference[i].decode(a.data());
+			for (Chunk const* other : { &spans[i], &threaded[i] })
+			{
+				other->decode(b.data());
+				mismatches += a != b;
+			}
+		}
+		std::cout << "\t" << mismatches << " chunks differing from the voxel by voxel fill" << std::endl;
+
+		// The columns of the chunks, from the noise every time vs from the tiles cached by the fills above
+		std::vector<World::ColumnInfo> columns(size_t(dims.x) * dims.z);
+		chunkMs("columns from the noise", timeMs([&]()
+			{
+				for (size_t i = 0; i < ids.size(); ++i)
+					world.generateColumnInfos(ids[i], columns.data());
+			}
+		));
+		chunkMs("columns from the cache", timeMs([&]()
+			{
+				for (size_t i = 0; i < ids.size(); ++i)
+					world.columnInfos(ids[i], columns.data());
+			}
+		));
+		const TileCache<World::ColumnInfo>& cache = world.columnCache();
+		std::cout << "\t" << cache.tileCount() << " tiles of " << cache.TileSize << "x" << cache.TileSize << " columns cached, ";
+		std::cout << cache.hits() << " hits, " << cache.misses() << " misses" << std::endl;
+	}
+}
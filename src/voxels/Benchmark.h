@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+
+// Micro benchmarks of the voxel engine, run with: Voxels --bench <name> (or --bench all)
+// They run after the creation of the GL context, so they can use it.
+namespace bench
+{
+	// Returns false if there is no benchmark called name
+	bool run(std::string const& name);
+
+	void listBenchmarks();
+
+	template <class Func>
+	double timeMs(Func const& f)
+	{
+		const auto t0 = std::chrono::steady_clock::now();
+		f();
+		const auto t1 = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(t1 - t0).count();
+	}
+
+	// ChunkMap vs std::unordered_map (with the previous and the new hash)
+	void chunkMap();
+
+	// Loading chunks from the region files vs generating them with World::fillChunk
+	void regions();
+
+	// GradientNoise (scalar and batched) vs the previous trigonometric hash Perlin, for the columns of chunks
+	void noise();
+
+	// VoxelRaycaster (one by one, batched, on several threads) vs a plain voxel by voxel DDA, on a generated terrain
+	void raycast();
+
+	// Linear, Morton and bricked voxel orders inside the sections of the chunks (see ChunkLayout.h), on neighbour heavy
+	// work: face culling by reading the 6 neighbours of each voxel, decode (what the meshers start with) and per voxel raycasts,
+	// and the linear one with compile time dimensions (FixedChunk)
+	void layout();
+
+	// World::fillChunk (runs of the columns written section by section) vs the previous voxel by voxel fill,
+	// on one thread and with a chunk per job on all the workers, and the columns of the chunks from the noise vs from the
+	// tiles of the column cache
+	void fill();
+}
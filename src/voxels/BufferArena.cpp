@@ -0,0 +1,131 @@
+#include <voxels/BufferArena.h>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+BufferArena::BufferArena():
+	_handle(0),
+	_capacity(0),
+	_used(0)
+{}
+
+BufferArena::~BufferArena()
+{
+	if (_handle)
+		glDeleteBuffers(1, &_handle);
+}
+
+size_t BufferArena::alignedSize(size_t bytes)
+{
+	return (bytes + Alignment - 1) / Alignment * Alignment;
+}
+
+void BufferArena::grow(size_t min_capacity)
+{
+	size_t capacity = std::max(_capacity * 2, InitialCapacity);
+	while (capacity < min_capacity)
+		capacity *= 2;
+
+	GLuint handle;
+	glCreateBuffers(1, &handle);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (_handle)
+	{
+		glCopyNamedBufferSubData(_handle, handle, 0, 0, _capacity);
+		glDeleteBuffers(1, &_handle);
+	}
+	_handle = handle;
+	addFree(_capacity, capacity - _capacity);
+	_capacity = capacity;
+}
+
+void BufferArena::addFree(size_t offset, size_t size)
+{
+	auto next = _free.lower_bound(offset);
+	if (next != _free.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= offset);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			_free.erase(prev);
+		}
+	}
+	if (next != _free.end() && offset + size == next->first)
+	{
+		size += next->second;
+		_free.erase(next);
+	}
+	_free[offset] = size;
+}
+
+BufferArena::Range BufferArena::allocate(size_t bytes)
+{
+	if (bytes == 0)
+		return {};
+	const size_t size = alignedSize(bytes);
+	auto it = std::find_if(_free.begin(), _free.end(), [size](auto const& range) {return range.second >= size; });
+	if (it == _free.end())
+	{
+		// The free range at the end (if any) is extended by the growth
+		const size_t tail = !_free.empty() && _free.rbegin()->first + _free.rbegin()->second == _capacity ? _free.rbegin()->second : 0;
+		grow(_capacity - tail + size);
+		it = std::prev(_free.end());
+	}
+	const Range res = { it->first, size };
+	const size_t remaining = it->second - size;
+	_free.erase(it);
+	if (remaining)
+		_free[res.offset + size] = remaining;
+	_used += size;
+	return res;
+}
+
+void BufferArena::release(Range const& range)
+{
+	if (range.size == 0)
+		return;
+	assert(range.offset + range.size <= _capacity);
+	_used -= range.size;
+	addFree(range.offset, range.size);
+}
+
+void BufferArena::upload(Range const& range, const void* data, size_t bytes)
+{
+	assert(bytes <= range.size);
+	if (bytes == 0)
+		return;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, range.offset, bytes, data);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+GLuint BufferArena::handle()const
+{
+	return _handle;
+}
+
+void BufferArena::bind(GLenum target, int index)const
+{
+	assert(_handle != 0);
+	glBindBufferBase(target, index, _handle);
+}
+
+size_t BufferArena::capacity()const
+{
+	return _capacity;
+}
+
+size_t BufferArena::usedBytes()const
+{
+	return _used;
+}
+
+size_t BufferArena::freeRanges()const
+{
+	return _free.size();
+}
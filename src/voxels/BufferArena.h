@@ -0,0 +1,75 @@
+#pragma once
+
+#include <map>
+#include <glad/glad.h>
+
+// A single GL buffer sub-allocated in ranges, so that the data of all the chunks can be bound once and drawn
+// with a single multi draw. First fit in a free list sorted by offset, coalesced on release.
+// When full, the buffer is replaced by one twice as large and the old content copied: the ranges keep their
+// offsets but the handle changes, so it has to be read when binding. GL thread only.
+class BufferArena
+{
+public:
+
+	// Of the offsets and sizes of the ranges, so that they can be bound as SSBO ranges of vec4 or uint
+	static constexpr size_t Alignment = 16;
+
+	static constexpr size_t InitialCapacity = size_t(16) << 20;
+
+	struct Range
+	{
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	// Layout of the commands of glMultiDrawArraysIndirect, for the multi draws reading their data from arenas
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instance_count;
+		GLuint first;
+		GLuint base_instance;
+	};
+
+protected:
+
+	GLuint _handle;
+	size_t _capacity;
+	size_t _used;
+	// offset -> size
+	std::map<size_t, size_t> _free;
+
+	void grow(size_t min_capacity);
+
+	// Adds [offset, offset + size) to the free list, merged with its neighbours
+	void addFree(size_t offset, size_t size);
+
+public:
+
+	BufferArena();
+
+	BufferArena(BufferArena const&) = delete;
+
+	~BufferArena();
+
+	static size_t alignedSize(size_t bytes);
+
+	// A range of at least bytes bytes (empty if bytes == 0)
+	Range allocate(size_t bytes);
+
+	// range must come from allocate
+	void release(Range const& range);
+
+	void upload(Range const& range, const void* data, size_t bytes);
+
+	GLuint handle()const;
+
+	void bind(GLenum target, int index)const;
+
+	size_t capacity()const;
+
+	size_t usedBytes()const;
+
+	// Number of ranges of the free list, a measure of the fragmentation
+	size_t freeRanges()const;
+};
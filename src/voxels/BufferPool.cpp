@@ -0,0 +1,81 @@
+#include <voxels/BufferPool.h>
+#include <cassert>
+
+BufferPool::BufferPool():
+	_free_bytes(0),
+	_allocated_buffers(0)
+{}
+
+BufferPool::~BufferPool()
+{
+	clear();
+}
+
+size_t BufferPool::sizeClass(size_t bytes)
+{
+	size_t res = 0;
+	while ((MinCapacity << res) < bytes)
+		++res;
+	return res;
+}
+
+size_t BufferPool::capacityFor(size_t bytes)
+{
+	return MinCapacity << sizeClass(bytes);
+}
+
+GLuint BufferPool::acquire(size_t bytes, size_t& capacity)
+{
+	const size_t c = sizeClass(bytes);
+	capacity = MinCapacity << c;
+	if (c < _free.size() && !_free[c].empty())
+	{
+		const GLuint res = _free[c].back();
+		_free[c].pop_back();
+		_free_bytes -= capacity;
+		return res;
+	}
+	GLuint res;
+	glCreateBuffers(1, &res);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, res);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	++_allocated_buffers;
+	return res;
+}
+
+void BufferPool::release(GLuint handle, size_t capacity)
+{
+	assert(capacity == capacityFor(capacity));
+	if (_free_bytes + capacity > MaxFreeBytes)
+	{
+		glDeleteBuffers(1, &handle);
+		return;
+	}
+	const size_t c = sizeClass(capacity);
+	if (c >= _free.size())
+		_free.resize(c + 1);
+	_free[c].push_back(handle);
+	_free_bytes += capacity;
+}
+
+void BufferPool::clear()
+{
+	for (std::vector<GLuint>& buffers : _free)
+	{
+		if (!buffers.empty())
+			glDeleteBuffers(GLsizei(buffers.size()), buffers.data());
+		buffers.clear();
+	}
+	_free_bytes = 0;
+}
+
+size_t BufferPool::freeBytes()const
+{
+	return _free_bytes;
+}
+
+size_t BufferPool::allocatedBuffers()const
+{
+	return _allocated_buffers;
+}
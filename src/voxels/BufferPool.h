@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+
+// Recycles GL buffers instead of deleting and recreating them.
+// Buffers are allocated with a power of two capacity (at least MinCapacity bytes) and
+// kept in a free list per capacity, up to MaxFreeBytes in total. GL thread only.
+class BufferPool
+{
+public:
+
+	static constexpr size_t MinCapacity = 4096;
+
+	static constexpr size_t MaxFreeBytes = size_t(64) << 20;
+
+protected:
+
+	// [i] -> buffers of MinCapacity << i bytes
+	std::vector<std::vector<GLuint>> _free;
+
+	size_t _free_bytes;
+
+	size_t _allocated_buffers;
+
+	static size_t sizeClass(size_t bytes);
+
+public:
+
+	BufferPool();
+
+	BufferPool(BufferPool const&) = delete;
+
+	~BufferPool();
+
+	static size_t capacityFor(size_t bytes);
+
+	// Returns a buffer of at least bytes bytes, its actual size is written in capacity
+	GLuint acquire(size_t bytes, size_t& capacity);
+
+	// capacity must be the one returned by acquire
+	void release(GLuint handle, size_t capacity);
+
+	// Deletes the free buffers
+	void clear();
+
+	size_t freeBytes()const;
+
+	// Number of glBufferData allocations since the creation of the pool
+	size_t allocatedBuffers()const;
+};
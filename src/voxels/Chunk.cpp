@@ -1,154 +1,435 @@
 #include <voxels/Chunk.h>
+#include <algorithm>
 
-Chunk::Chunk(glm::ivec3 size):
-	_dims(size),
-	_strides(size.y* size.z, size.z, 1),
-	_voxels(std::vector<Voxel>(size.x* size.y* size.z)),
-	_handle(0)
-{}
+template <class Layout, class Shape>
+BasicChunk<Layout, Shape>::BasicChunk(glm::ivec3 size, bool compressed):
+	Shape(size),
+	_section_size(size_t(size.x)* SectionHeight* size.z),
+	_index_terms(size_t(size.x) + SectionHeight + size.z),
+	_sections(size.y / SectionHeight, PaletteStorage(size_t(size.x)* SectionHeight* size.z, !compressed)),
+	_handle(0),
+	_ssbo_size(0),
+	_pool(nullptr),
+	_arena(nullptr),
+	_column_words((size.y + ColumnWordBits - 1) / ColumnWordBits),
+	_occupancy(size_t(size.x) * size.z * _column_words, 0)
+{
+	assert(size.y % SectionHeight == 0);
+	const glm::ivec3 section_dims = sectionDims();
+	uint32_t* terms = _index_terms.data();
+	for (int a = 0; a < 3; ++a)
+	{
+		for (int c = 0; c < section_dims[a]; ++c)
+			*(terms++) = uint32_t(Layout::term(a, c, section_dims));
+	}
+	updateLayout();
+	_dirty.markAll();
+}
 
 
-Chunk::Chunk(Chunk&& other) :
-	_dims(std::move(other._dims)),
-	_strides(std::move(other._strides)),
-	_voxels(std::move(other._voxels)),
-	_handle(other._handle)
+template <class Layout, class Shape>
+BasicChunk<Layout, Shape>::BasicChunk(BasicChunk&& other) :
+	Shape(other),
+	_section_size(other._section_size),
+	_index_terms(std::move(other._index_terms)),
+	_sections(std::move(other._sections)),
+	_handle(other._handle),
+	_ssbo_size(other._ssbo_size),
+	_pool(other._pool),
+	_arena(other._arena),
+	_range(other._range),
+	_section_offsets(std::move(other._section_offsets)),
+	_dirty(std::move(other._dirty)),
+	_column_words(other._column_words),
+	_occupancy(std::move(other._occupancy))
 {
 	other._handle = 0;
+	other._ssbo_size = 0;
+	other._arena = nullptr;
+	other._range = {};
 }
 
-Chunk::~Chunk()
+template <class Layout, class Shape>
+BasicChunk<Layout, Shape>::~BasicChunk()
 {
 	deleteSSBO();
 }
 
 
-glm::ivec3 Chunk::strides()const
+template <class Layout, class Shape>
+size_t BasicChunk<Layout, Shape>::paletteSlots(PaletteStorage const& section)
 {
-	return _strides;
+	return section.direct() ? 0 : (size_t(1) << section.bits());
 }
 
-glm::ivec3 Chunk::dims()const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::updateLayout()
 {
-	return _dims;
+	_section_offsets.resize(_sections.size() + 1);
+	size_t offset = 2 * _sections.size();
+	for (size_t s = 0; s < _sections.size(); ++s)
+	{
+		_section_offsets[s] = offset;
+		offset += paletteSlots(_sections[s]) + _sections[s].words().size();
+	}
+	_section_offsets.back() = offset;
 }
 
-size_t Chunk::size()const
+template <class Layout, class Shape>
+size_t BasicChunk<Layout, Shape>::byteSize()const
 {
-	return _dims.x * _dims.y * _dims.z;
+	return _section_offsets.back() * sizeof(uint32_t);
 }
 
-size_t Chunk::byteSize()const
+template <class Layout, class Shape>
+size_t BasicChunk<Layout, Shape>::memoryUsage()const
 {
-	return size() * sizeof(Voxel);
+	size_t res = 0;
+	for (PaletteStorage const& section : _sections)
+		res += section.memoryUsage();
+	res += _occupancy.size() * sizeof(uint64_t);
+	return res;
 }
 
-GLuint Chunk::handle()const
+template <class Layout, class Shape>
+size_t BasicChunk<Layout, Shape>::deviceMemoryUsage()const
 {
-	return _handle;
+	return hasSSBO() ? _ssbo_size : 0;
 }
 
-size_t Chunk::arrayId(glm::ivec3 const& gid)const
+template <class Layout, class Shape>
+PaletteStorage const& BasicChunk<Layout, Shape>::section(int s)const
 {
-	return gid.x * _strides.x + gid.y * _strides.y + gid.z * _strides.z;
+	return _sections[s];
 }
 
-Voxel& Chunk::operator()(glm::ivec3 const& gid)
+template <class Layout, class Shape>
+GLuint BasicChunk<Layout, Shape>::handle()const
 {
-	return _voxels[arrayId(gid)];
+	return _arena ? _arena->handle() : _handle;
 }
 
-Voxel const& Chunk::operator()(glm::ivec3 const& gid)const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::set(size_t aid, Voxel v)
 {
-	return _voxels[arrayId(gid)];
+	const size_t s = aid / sectionSize();
+	const size_t local = aid % sectionSize();
+	PaletteStorage& section = _sections[s];
+	const uint32_t bits = section.bits();
+	const size_t palette_size = section.palette().size();
+	section.set(local, v);
+
+	const glm::ivec3 p = localCoords(local);
+	const int y = int(s * SectionHeight) + p.y;
+	uint64_t& word = _occupancy[(size_t(p.x) * dims().z + p.z) * columnWords() + y / ColumnWordBits];
+	const uint64_t bit = uint64_t(1) << (y % ColumnWordBits);
+	word = v.id != 0 ? (word | bit) : (word & ~bit);
+
+	if (section.bits() != bits)
+	{
+		// Repacked, the following sections moved
+		updateLayout();
+		_dirty.markAll();
+	}
+	else
+	{
+		const size_t offset = _section_offsets[s];
+		if (section.palette().size() != palette_size)
+			_dirty.add(offset + palette_size);
+		if (bits == PaletteStorage::DirectBits)
+			_dirty.add(offset + local);
+		else if (bits != 0)
+			_dirty.add(offset + paletteSlots(section) + local / (32 / bits));
+	}
 }
 
-Voxel& Chunk::operator()(size_t aid)
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::setSectionOccupancy(int s, Voxel const* values)
 {
-	return _voxels[aid];
+	fillSectionOccupancy(s, false);
+	const int y0 = s * SectionHeight;
+	const glm::ivec3 dims = this->dims();
+	const int column_words = columnWords();
+	for (int x = 0; x < dims.x; ++x)
+	{
+		for (int y = 0; y < SectionHeight; ++y)
+		{
+			const int w = (y0 + y) / ColumnWordBits;
+			const uint64_t bit = uint64_t(1) << ((y0 + y) % ColumnWordBits);
+			uint64_t* column = _occupancy.data() + size_t(x) * dims.z * column_words + w;
+			for (int z = 0; z < dims.z; ++z)
+			{
+				if (values[localId(x, y, z)].id != 0)
+					column[size_t(z) * column_words] |= bit;
+			}
+		}
+	}
 }
 
-Voxel const& Chunk::operator()(size_t aid)const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::fillSectionOccupancy(int s, bool occupied)
 {
-	return _voxels[aid];
+	static_assert(ColumnWordBits % SectionHeight == 0);
+	const int y0 = s * SectionHeight;
+	const int w = y0 / ColumnWordBits;
+	const uint64_t mask = ((uint64_t(1) << SectionHeight) - 1) << (y0 % ColumnWordBits);
+	for (size_t c = 0; c < size_t(dims().x) * dims().z; ++c)
+	{
+		uint64_t& word = _occupancy[c * columnWords() + w];
+		word = occupied ? (word | mask) : (word & ~mask);
+	}
 }
 
-Voxel& Chunk::operator[](size_t aid)
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::fill(Voxel v)
 {
-	return _voxels[aid];
+	for (PaletteStorage& section : _sections)
+		section.fill(v);
+	for (int s = 0; s < sectionCount(); ++s)
+		fillSectionOccupancy(s, v.id != 0);
+	updateLayout();
+	_dirty.markAll();
 }
 
-Voxel const& Chunk::operator[](size_t aid)const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::assign(Voxel const* values)
 {
-	return _voxels[aid];
+	for (size_t s = 0; s < _sections.size(); ++s)
+	{
+		_sections[s].assign(values + s * sectionSize());
+		setSectionOccupancy(int(s), values + s * sectionSize());
+	}
+	updateLayout();
+	_dirty.markAll();
 }
 
-void Chunk::createSSBO(bool send_data)
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::assignSection(int s, Voxel const* values)
 {
-	assert(_handle == 0);
-	glCreateBuffers(1, &_handle);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
-	void* ptr = send_data ? _voxels.data() : nullptr;
-	glBufferData(GL_SHADER_STORAGE_BUFFER, byteSize(), ptr, GL_DYNAMIC_READ);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	_sections[s].assign(values);
+	setSectionOccupancy(s, values);
+	updateLayout();
+	_dirty.markAll();
 }
 
-void Chunk::updateSSBO()
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::fillSection(int s, Voxel v)
 {
-	assert(_handle != 0);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
-	// TODO optimize by sending only the part that needs to be updated
-	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, byteSize(), _voxels.data());
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	_sections[s].fill(v);
+	fillSectionOccupancy(s, v.id != 0);
+	updateLayout();
+	_dirty.markAll();
 }
 
-void Chunk::deleteSSBO()
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::decode(int32_t* dst)const
 {
-	if (_handle)
-		glDeleteBuffers(1, &_handle);
-	_handle = 0;
+	const glm::ivec3 dims = this->dims();
+	const size_t layer = size_t(SectionHeight) * dims.z;
+	for (int s = 0; s < sectionCount(); ++s)
+	{
+		const PaletteStorage& section = _sections[s];
+		const size_t y0 = size_t(s) * SectionHeight;
+		for (int x = 0; x < dims.x; ++x)
+		{
+			int32_t* column = dst + (size_t(x) * dims.y + y0) * dims.z;
+			if (section.uniform())
+			{
+				std::fill_n(column, layer, section.palette()[0].id);
+			}
+			else
+			{
+				for (int y = 0; y < SectionHeight; ++y)
+					for (int z = 0; z < dims.z; ++z)
+						*(column++) = section.get(localId(x, y, z)).id;
+			}
+		}
+	}
 }
 
-void Chunk::bind(int offset)
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::compact()
 {
-	assert(_handle != 0);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, _handle);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	for (PaletteStorage& section : _sections)
+		section.compact();
+	updateLayout();
+	_dirty.markAll();
 }
 
-void Chunk::unBind(int offset)
+template <class Layout, class Shape>
+bool BasicChunk<Layout, Shape>::dirty()const
 {
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, 0);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return !_dirty.empty();
+}
+
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::writeSSBOWords(size_t begin, size_t end, uint32_t* dst)const
+{
+	size_t w = begin;
+	for (; w < end && w < 2 * _sections.size(); ++w)
+	{
+		const size_t s = w / 2;
+		*(dst++) = (w % 2 == 0) ? uint32_t(_section_offsets[s]) : _sections[s].bits();
+	}
+	for (size_t s = 0; s < _sections.size() && w < end; ++s)
+	{
+		const size_t section_end = _section_offsets[s + 1];
+		if (w >= section_end)
+			continue;
+		const PaletteStorage& section = _sections[s];
+		const size_t data_begin = _section_offsets[s] + paletteSlots(section);
+		for (; w < end && w < data_begin; ++w)
+		{
+			const size_t p = w - _section_offsets[s];
+			*(dst++) = p < section.palette().size() ? uint32_t(section.palette()[p].id) : 0;
+		}
+		if (w < end && w < section_end)
+		{
+			const size_t n = std::min(end, section_end) - w;
+			std::copy_n(section.words().data() + (w - data_begin), n, dst);
+			dst += n;
+			w += n;
+		}
+	}
 }
 
-const auto& Chunk::begin()const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::allocateSSBO(size_t bytes)
 {
-	return _voxels.begin();
+	if (_arena)
+	{
+		_range = _arena->allocate(bytes);
+		_ssbo_size = _range.size;
+	}
+	else if (_pool)
+	{
+		_handle = _pool->acquire(bytes, _ssbo_size);
+	}
+	else
+	{
+		glCreateBuffers(1, &_handle);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+		_ssbo_size = bytes;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, _ssbo_size, nullptr, GL_DYNAMIC_READ);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
 }
 
-const auto& Chunk::end()const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::releaseSSBO()
 {
-	return _voxels.end();
+	if (_arena)
+	{
+		_arena->release(_range);
+		_range = {};
+	}
+	else if (_handle)
+	{
+		if (_pool)
+			_pool->release(_handle, _ssbo_size);
+		else
+			glDeleteBuffers(1, &_handle);
+	}
+	_handle = 0;
+	_ssbo_size = 0;
 }
 
-const auto& Chunk::cbegin()const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::createSSBO(bool send_data, BufferPool* pool)
 {
-	return _voxels.cbegin();
+	assert(!hasSSBO());
+	_pool = pool;
+	allocateSSBO(byteSize());
+	_dirty.markAll();
+	if (send_data)
+		updateSSBO();
 }
 
-const auto& Chunk::cend()const
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::createSSBO(BufferArena& arena, bool send_data)
 {
-	return _voxels.cend();
+	assert(!hasSSBO());
+	_arena = &arena;
+	allocateSSBO(byteSize());
+	_dirty.markAll();
+	if (send_data)
+		updateSSBO();
 }
 
-auto Chunk::begin()
+template <class Layout, class Shape>
+GLuint BasicChunk<Layout, Shape>::firstWord()const
 {
-	return _voxels.begin();
+	return _arena ? GLuint(_range.offset / sizeof(uint32_t)) : 0;
 }
 
-auto Chunk::end()
+template <class Layout, class Shape>
+size_t BasicChunk<Layout, Shape>::updateSSBO()
 {
-	return _voxels.end();
-}
\ No newline at end of file
+	assert(hasSSBO());
+	if (!dirty())
+		return 0;
+	if (byteSize() > _ssbo_size)
+	{
+		// A palette grew
+		releaseSSBO();
+		allocateSSBO(byteSize());
+		_dirty.markAll();
+	}
+	if (!_arena)
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+	thread_local std::vector<uint32_t> staging;
+	size_t res = 0;
+	const auto upload = [&](size_t begin, size_t end)
+	{
+		staging.resize(end - begin);
+		writeSSBOWords(begin, end, staging.data());
+		const size_t bytes = staging.size() * sizeof(uint32_t);
+		if (_arena)
+			_arena->upload({ _range.offset + begin * sizeof(uint32_t), bytes }, staging.data(), bytes);
+		else
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, begin * sizeof(uint32_t), bytes, staging.data());
+		res += bytes;
+	};
+	if (_dirty.all())
+	{
+		upload(0, _section_offsets.back());
+	}
+	else
+	{
+		for (DirtyRanges::Range const& range : _dirty.coalesce(UploadMaxGap))
+			upload(range.begin, std::min(range.end, _section_offsets.back()));
+	}
+	if (!_arena)
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	_dirty.clear();
+	return res;
+}
+
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::deleteSSBO()
+{
+	releaseSSBO();
+	_pool = nullptr;
+	_arena = nullptr;
+}
+
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::bind(int offset)
+{
+	assert(_handle != 0 && !_arena);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, _handle);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+template <class Layout, class Shape>
+void BasicChunk<Layout, Shape>::unBind(int offset)
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+template class BasicChunk<LinearLayout>;
+template class BasicChunk<MortonLayout>;
+template class BasicChunk<BrickedLayout>;
+template class BasicChunk<LinearLayout, FixedShape<32, 256, 32>>;
@@ -4,76 +4,314 @@
 #include <glad/glad.h>
 #include <cassert>
 #include <glm/glm.hpp>
+#include <voxels/Voxel.h>
+#include <voxels/PaletteStorage.h>
+#include <voxels/DirtyRanges.h>
+#include <voxels/BufferPool.h>
+#include <voxels/BufferArena.h>
+#include <voxels/ChunkLayout.h>
+#include <voxels/ChunkShape.h>
+#include <type_traits>
+#include <bit>
+
+// The chunk is split in vertical sections of SectionHeight layers, each palette compressed on its own
+// (see PaletteStorage), so a uniform section (all air, all stone...) is stored as a single value.
+// Array ids are section major: aid = section * sectionSize() + localId(x, y % SectionHeight, z), the order inside
+// a section being given by the Layout policy (see ChunkLayout.h), linear by default.
+// The SSBO holds the same packed representation, as an array of uint words:
+// - words[2 * s] = offset of the section s, words[2 * s + 1] = bits per voxel of the section s
+// - at the offset of a section: its palette (2^bits slots, none if bits == 32) followed by its packed indices
+//   (or the ids directly if bits == 32). The palette slots let it grow without moving the data.
+// Writes are tracked so that updateSSBO only sends the modified words. The SSBO can be a range of a BufferArena
+// shared by the chunks, read from firstWord().
+// An occupancy bitset (bit set <=> id != 0) is kept up to date by all the writes: a column (x, z) is columnWords()
+// 64 bits words along y (bit y % 64 of the word y / 64), so 64 voxels are tested with a single word operation.
+// The dimensions come from the Shape base (see ChunkShape.h): given at run time, or at compile time (FixedChunk)
+// where the index math becomes shifts and the occupancy and index tables come from a SlabAllocator.
+template <class Layout, class Shape = DynamicShape>
+class BasicChunk : protected Shape
+{
+public:
 
+	using LayoutType = Layout;
 
+	using ShapeType = Shape;
 
-struct Voxel
-{
-	int32_t id;
-};
+	using Shape::dims;
+
+	// Proxy returned by the non const accessors, since a packed voxel can not be referenced
+	class VoxelRef
+	{
+	protected:
+
+		BasicChunk& _chunk;
+		size_t _aid;
+
+	public:
+
+		VoxelRef(BasicChunk& chunk, size_t aid) :
+			_chunk(chunk),
+			_aid(aid)
+		{}
+
+		operator Voxel()const
+		{
+			return _chunk.get(_aid);
+		}
+
+		VoxelRef& operator=(Voxel v)
+		{
+			_chunk.set(_aid, v);
+			return *this;
+		}
+
+		VoxelRef& operator=(VoxelRef const& other)
+		{
+			return operator=(Voxel(other));
+		}
+	};
+
+	static constexpr int SectionHeight = 16;
+
+	static constexpr int ColumnWordBits = 64;
+
+	// Dirty ranges closer than that (in words) are uploaded in a single call
+	static constexpr size_t UploadMaxGap = 16;
 
-class Chunk
-{
 protected:
 
-	glm::ivec3 _dims, _strides;
-	std::vector<Voxel> _voxels;
+	// Sizes for the fixed shapes (0 for the dynamic ones)
+	static constexpr size_t FixedSectionSize = size_t(Shape::SizeX) * SectionHeight * Shape::SizeZ;
+	static constexpr int FixedColumnWords = (Shape::SizeY + ColumnWordBits - 1) / ColumnWordBits;
+	static constexpr size_t FixedOccupancyWords = size_t(Shape::SizeX) * Shape::SizeZ * FixedColumnWords;
+	static constexpr size_t FixedIndexTerms = size_t(Shape::SizeX) + SectionHeight + Shape::SizeZ;
+
+	size_t _section_size;
+	// Index terms of the layout: [0, dims.x) for x, then [0, SectionHeight) for y, then [0, dims.z) for z
+	typename Shape::template Buffer<uint32_t, FixedIndexTerms> _index_terms;
+	std::vector<PaletteStorage> _sections;
 	GLuint _handle;
+	// Capacity of the SSBO
+	size_t _ssbo_size;
+	// Where the SSBO comes from, nullptr -> owned
+	BufferPool* _pool;
+	// Not nullptr: the SSBO is the range _range of the arena (_handle is 0 then)
+	BufferArena* _arena;
+	BufferArena::Range _range;
 
-public:
+	// Offsets of the sections in the SSBO (in words), the last one is the total size
+	std::vector<size_t> _section_offsets;
+
+	// In words of the SSBO
+	DirtyRanges _dirty;
 
+	int _column_words;
+	// [(x * dims.z + z) * _column_words + y / 64]
+	typename Shape::template Buffer<uint64_t, FixedOccupancyWords> _occupancy;
 
-	Chunk(glm::ivec3 size = { 0, 0, 0 });
+	// Section s of the occupancy from values[0, sectionSize())
+	void setSectionOccupancy(int s, Voxel const* values);
 
-	Chunk(Chunk const&) = delete;
+	void fillSectionOccupancy(int s, bool occupied);
 
-	Chunk(Chunk&& other);
+	static size_t paletteSlots(PaletteStorage const& section);
 
-	~Chunk();
+	void updateLayout();
 
-	glm::ivec3 strides()const;
+	void allocateSSBO(size_t bytes);
 
-	glm::ivec3 dims()const;
+	void releaseSSBO();
 
-	size_t size()const;
+	bool hasSSBO()const
+	{
+		return _handle != 0 || _arena != nullptr;
+	}
 
+	// Copies the words [begin, end) of the SSBO representation to dst
+	void writeSSBOWords(size_t begin, size_t end, uint32_t* dst)const;
+
+public:
+
+	// compressed = false -> 32 bits per voxel
+	BasicChunk(glm::ivec3 size = glm::ivec3(Shape::SizeX, Shape::SizeY, Shape::SizeZ), bool compressed = true);
+
+	BasicChunk(BasicChunk const&) = delete;
+
+	BasicChunk(BasicChunk&& other);
+
+	~BasicChunk();
+
+	// Index of (x, y, z) inside a section, y in [0, SectionHeight)
+	size_t localId(int x, int y, int z)const
+	{
+		if constexpr (Shape::Fixed && std::is_same_v<Layout, LinearLayout>)
+		{
+			constexpr int shift_y = std::countr_zero(unsigned(Shape::SizeZ));
+			constexpr int shift_x = shift_y + std::countr_zero(unsigned(SectionHeight));
+			return (size_t(x) << shift_x) | (size_t(y) << shift_y) | size_t(z);
+		}
+		else
+		{
+			const int dx = dims().x;
+			return size_t(_index_terms[x]) + _index_terms[dx + y] + _index_terms[dx + SectionHeight + z];
+		}
+	}
+
+	// Inverse of localId
+	glm::ivec3 localCoords(size_t local)const
+	{
+		return Layout::coords(local, sectionDims());
+	}
+
+	glm::ivec3 sectionDims()const
+	{
+		return { dims().x, SectionHeight, dims().z };
+	}
+
+	size_t size()const
+	{
+		return sectionSize() * sectionCount();
+	}
+
+	// Size of the SSBO
 	size_t byteSize()const;
 
+	// Host memory used by the voxels
+	size_t memoryUsage()const;
+
+	// Size of the SSBO buffer (can be larger than byteSize)
+	size_t deviceMemoryUsage()const;
+
+	int sectionCount()const
+	{
+		if constexpr (Shape::Fixed)
+			return Shape::SizeY / SectionHeight;
+		else
+			return int(_sections.size());
+	}
+
+	size_t sectionSize()const
+	{
+		if constexpr (Shape::Fixed)
+			return FixedSectionSize;
+		else
+			return _section_size;
+	}
+
+	PaletteStorage const& section(int s)const;
+
+	int columnWords()const
+	{
+		if constexpr (Shape::Fixed)
+			return FixedColumnWords;
+		else
+			return _column_words;
+	}
+
+	// The columnWords() occupancy words of the column (x, z)
+	uint64_t const* occupancyColumn(int x, int z)const
+	{
+		return _occupancy.data() + (size_t(x) * dims().z + z) * columnWords();
+	}
+
+	bool occupied(glm::ivec3 const& gid)const
+	{
+		return (occupancyColumn(gid.x, gid.z)[gid.y / ColumnWordBits] >> (gid.y % ColumnWordBits)) & 1u;
+	}
+
 	GLuint handle()const;
 
-	size_t arrayId(glm::ivec3 const& gid)const;
+	size_t arrayId(glm::ivec3 const& gid)const
+	{
+		const int s = gid.y / SectionHeight;
+		return s * sectionSize() + localId(gid.x, gid.y - s * SectionHeight, gid.z);
+	}
+
+	Voxel get(size_t aid)const
+	{
+		return _sections[aid / sectionSize()].get(aid % sectionSize());
+	}
+
+	VoxelRef operator()(glm::ivec3 const& gid)
+	{
+		return VoxelRef(*this, arrayId(gid));
+	}
+
+	Voxel operator()(glm::ivec3 const& gid)const
+	{
+		return get(arrayId(gid));
+	}
+
+	VoxelRef operator()(size_t aid)
+	{
+		return VoxelRef(*this, aid);
+	}
+
+	Voxel operator()(size_t aid)const
+	{
+		return get(aid);
+	}
 
-	Voxel& operator()(glm::ivec3 const& gid);
+	VoxelRef operator[](size_t aid)
+	{
+		return VoxelRef(*this, aid);
+	}
 
-	Voxel const& operator()(glm::ivec3 const& gid)const;
+	Voxel operator[](size_t aid)const
+	{
+		return get(aid);
+	}
 
-	Voxel& operator()(size_t aid);
+	void set(size_t aid, Voxel v);
 
-	Voxel const& operator()(size_t aid)const;
+	void fill(Voxel v);
 
-	Voxel& operator[](size_t aid);
+	// Replaces all the voxels with values[0, size()), indexed by array id
+	void assign(Voxel const* values);
 
-	Voxel const& operator[](size_t aid)const;
+	// Replaces the voxels of the section s with values[0, sectionSize())
+	void assignSection(int s, Voxel const* values);
 
-	void createSSBO(bool send_data = false);
+	void fillSection(int s, Voxel v);
 
-	void updateSSBO();
+	// Writes all the ids in a linear layout (x, y, z), z fastest: dst[(x * dims.y + y) * dims.z + z]
+	void decode(int32_t* dst)const;
 
+	// Shrinks the palettes of the sections to the values in use, call it after a large modification
+	void compact();
+
+	// Has modifications that are not in the SSBO yet
+	bool dirty()const;
+
+	// The SSBO is taken from (and given back to) pool if not nullptr
+	void createSSBO(bool send_data = false, BufferPool* pool = nullptr);
+
+	// The SSBO is a range of arena, bound by the user (see firstWord)
+	void createSSBO(BufferArena& arena, bool send_data = false);
+
+	// Index of the first word of the SSBO in its buffer (0 unless in an arena)
+	GLuint firstWord()const;
+
+	// Uploads the dirty parts, returns the number of bytes sent
+	size_t updateSSBO();
+
+	// Gives the SSBO back to its pool or arena if it has one
 	void deleteSSBO();
 
 	void bind(int offset = 0);
 
 	void unBind(int offset = 0);
+};
 
-	const auto& begin()const;
-
-	const auto& end()const;
-
-	const auto& cbegin()const;
+// Defined in Chunk.cpp for these layouts
+extern template class BasicChunk<LinearLayout>;
+extern template class BasicChunk<MortonLayout>;
+extern template class BasicChunk<BrickedLayout>;
 
-	const auto& cend()const;
+extern template class BasicChunk<LinearLayout, FixedShape<32, 256, 32>>;
 
-	auto begin();
+using Chunk = BasicChunk<LinearLayout>;
 
-	auto end();
-};
\ No newline at end of file
+// Chunk with compile time dimensions (see FixedShape), defined in Chunk.cpp for 32x256x32 (the default of World)
+template <int X, int Y, int Z, class Layout = LinearLayout>
+using FixedChunk = BasicChunk<Layout, FixedShape<X, Y, Z>>;
@@ -0,0 +1,183 @@
+#include <voxels/ChunkApron.h>
+#include <algorithm>
+#include <cassert>
+
+ChunkApron::ChunkApron(glm::ivec3 dims):
+	_dims(dims),
+	_width(std::max(dims.x, dims.z)),
+	_side_words((size_t(dims.y) * _width + 31) / 32),
+	_bits(Sides * _side_words, 0),
+	_handle(0),
+	_buffer_size(0),
+	_pool(nullptr),
+	_arena(nullptr)
+{}
+
+ChunkApron::ChunkApron(ChunkApron&& other) :
+	_dims(other._dims),
+	_width(other._width),
+	_side_words(other._side_words),
+	_bits(std::move(other._bits)),
+	_handle(other._handle),
+	_buffer_size(other._buffer_size),
+	_pool(other._pool),
+	_arena(other._arena),
+	_range(other._range)
+{
+	other._handle = 0;
+	other._buffer_size = 0;
+	other._arena = nullptr;
+}
+
+ChunkApron::~ChunkApron()
+{
+	deleteBuffer();
+}
+
+ChunkApron& ChunkApron::operator=(ChunkApron&& other)
+{
+	deleteBuffer();
+	_dims = other._dims;
+	_width = other._width;
+	_side_words = other._side_words;
+	_bits = std::move(other._bits);
+	_handle = other._handle;
+	_buffer_size = other._buffer_size;
+	_pool = other._pool;
+	_arena = other._arena;
+	_range = other._range;
+	other._handle = 0;
+	other._buffer_size = 0;
+	other._arena = nullptr;
+	return *this;
+}
+
+void ChunkApron::clearSide(int n)
+{
+	std::fill_n(_bits.begin() + n * _side_words, _side_words, 0);
+}
+
+void ChunkApron::setSide(int n, Chunk const& neighbour, OpaqueTable const& opaque)
+{
+	assert(neighbour.dims() == _dims);
+	clearSide(n);
+	uint32_t* bits = _bits.data() + n * _side_words;
+	const auto set = [bits](size_t bit)
+	{
+		bits[bit / 32] |= 1u << (bit % 32);
+	};
+	// As the mesher, the connectivity and the light: the ids past the table are opaque
+	const auto isOpaque = [&opaque](Voxel v)
+	{
+		return v.id != 0 && (uint32_t(v.id) >= opaque.size() || opaque[v.id]);
+	};
+
+	// Plane of the neighbour facing this chunk: x fixed for the x sides, z fixed for the z sides
+	const bool x_side = n < 2;
+	const int plane = (n % 2 == 0) ? 0 : (x_side ? _dims.x - 1 : _dims.z - 1);
+	const int length = x_side ? _dims.z : _dims.x;
+	for (int s = 0; s < neighbour.sectionCount(); ++s)
+	{
+		const PaletteStorage& section = neighbour.section(s);
+		const int y0 = s * Chunk::SectionHeight;
+		if (section.uniform())
+		{
+			if (isOpaque(section.palette()[0]))
+			{
+				for (int y = y0; y < y0 + Chunk::SectionHeight; ++y)
+					for (int u = 0; u < length; ++u)
+						set(size_t(y) * _width + u);
+			}
+			continue;
+		}
+		for (int y = 0; y < Chunk::SectionHeight; ++y)
+		{
+			for (int u = 0; u < length; ++u)
+			{
+				const size_t local = x_side ? neighbour.localId(plane, y, u) : neighbour.localId(u, y, plane);
+				if (isOpaque(section.get(local)))
+					set(size_t(y0 + y) * _width + u);
+			}
+		}
+	}
+}
+
+size_t ChunkApron::byteSize()const
+{
+	return _bits.size() * sizeof(uint32_t);
+}
+
+size_t ChunkApron::deviceMemoryUsage()const
+{
+	return _buffer_size;
+}
+
+void ChunkApron::upload(BufferPool* pool)
+{
+	if ((_handle && (byteSize() > _buffer_size || pool != _pool)) || _arena)
+		deleteBuffer();
+	if (_handle == 0)
+	{
+		_pool = pool;
+		if (_pool)
+		{
+			_handle = _pool->acquire(byteSize(), _buffer_size);
+		}
+		else
+		{
+			glCreateBuffers(1, &_handle);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+			_buffer_size = std::max(byteSize(), sizeof(uint32_t));
+			glBufferData(GL_SHADER_STORAGE_BUFFER, _buffer_size, _bits.data(), GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			return;
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, byteSize(), _bits.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ChunkApron::upload(BufferArena& arena)
+{
+	if (_handle || (_arena && (byteSize() > _buffer_size || &arena != _arena)))
+		deleteBuffer();
+	if (!_arena)
+	{
+		_arena = &arena;
+		_range = _arena->allocate(byteSize());
+		_buffer_size = _range.size;
+	}
+	_arena->upload(_range, _bits.data(), byteSize());
+}
+
+GLuint ChunkApron::firstWord()const
+{
+	return _arena ? GLuint(_range.offset / sizeof(uint32_t)) : 0;
+}
+
+void ChunkApron::deleteBuffer()
+{
+	if (_arena)
+	{
+		_arena->release(_range);
+		_range = {};
+		_arena = nullptr;
+	}
+	else if (_handle)
+	{
+		if (_pool)
+			_pool->release(_handle, _buffer_size);
+		else
+			glDeleteBuffers(1, &_handle);
+	}
+	_handle = 0;
+	_buffer_size = 0;
+	_pool = nullptr;
+}
+
+void ChunkApron::bind(int offset)const
+{
+	assert(_handle != 0 && !_arena);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, _handle);
+}
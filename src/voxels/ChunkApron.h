@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+#include <voxels/BufferPool.h>
+#include <voxels/BufferArena.h>
+
+// One voxel apron around the 4 horizontal sides of a chunk: the opacity of the facing plane of each neighbour,
+// so that the faces against a chunk border can be culled like the inner ones.
+// Side n is the neighbour n of the ChunkMap (+x, -x, +z, -z), its bits are indexed by y * width() + u
+// with u = z for the x sides and u = x for the z sides. A side without neighbour is transparent.
+// The same words are uploaded in an SSBO (or a range of a BufferArena) for voxel.geom.
+class ChunkApron
+{
+public:
+
+	static constexpr int Sides = 4;
+
+protected:
+
+	glm::ivec3 _dims;
+	int _width;
+	size_t _side_words;
+	std::vector<uint32_t> _bits;
+	GLuint _handle;
+	size_t _buffer_size;
+	BufferPool* _pool;
+	// Not nullptr: the buffer is the range _range of the arena (_handle is 0 then)
+	BufferArena* _arena;
+	BufferArena::Range _range;
+
+public:
+
+	ChunkApron(glm::ivec3 dims = { 0, 0, 0 });
+
+	ChunkApron(ChunkApron const&) = delete;
+
+	ChunkApron(ChunkApron&& other);
+
+	~ChunkApron();
+
+	ChunkApron& operator=(ChunkApron&& other);
+
+	// Side n as the opposite side of neighbour
+	void setSide(int n, Chunk const& neighbour, OpaqueTable const& opaque);
+
+	void clearSide(int n);
+
+	int width()const
+	{
+		return _width;
+	}
+
+	bool opaque(int n, int y, int u)const
+	{
+		const size_t bit = size_t(y) * _width + u;
+		return (_bits[n * _side_words + bit / 32] >> (bit % 32)) & 1u;
+	}
+
+	// Side of the voxel in front of the face (axis, s) of a voxel of the border, -1 if it is not horizontal
+	static int side(int axis, int s)
+	{
+		return axis == 0 ? s : (axis == 2 ? 2 + s : -1);
+	}
+
+	size_t byteSize()const;
+
+	size_t deviceMemoryUsage()const;
+
+	// GL thread only, the buffer is taken from (and given back to) pool if not nullptr
+	void upload(BufferPool* pool = nullptr);
+
+	// GL thread only, in a range of arena, bound by the user (see firstWord)
+	void upload(BufferArena& arena);
+
+	// Index of the first word of the buffer in its arena (0 if not in an arena)
+	GLuint firstWord()const;
+
+	void deleteBuffer();
+
+	void bind(int offset = 2)const;
+};
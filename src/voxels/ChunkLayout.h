@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cassert>
+
+// Order of the voxels inside a section of a chunk: maps (x, y % SectionHeight, z) to an index in [0, sectionSize()).
+// The index is a sum of one term per axis, term(axis, coordinate, section dimensions),
+// so a chunk tabulates the terms once and an index costs 3 loads and 2 additions whatever the layout.
+// coords(index, section dimensions) is the inverse.
+// Id is the value of VOXEL_LAYOUT in the shaders (voxel.vert and voxel.geom have the matching index functions).
+
+// z fastest, then y, then x
+struct LinearLayout
+{
+	static constexpr int Id = 0;
+	static constexpr const char* Name = "linear";
+
+	static size_t term(int axis, int c, glm::ivec3 const& dims)
+	{
+		if (axis == 0)
+			return size_t(c) * dims.y * dims.z;
+		if (axis == 1)
+			return size_t(c) * dims.z;
+		return size_t(c);
+	}
+
+	static glm::ivec3 coords(size_t index, glm::ivec3 const& dims)
+	{
+		const size_t layer = size_t(dims.y) * dims.z;
+		return { int(index / layer), int((index % layer) / dims.z), int(index % dims.z) };
+	}
+};
+
+// Z-order curve: the bits of x, y and z interleaved (x lowest at each level), the axes with less bits
+// stop taking part once they are exhausted. The dimensions must be powers of two.
+struct MortonLayout
+{
+	static constexpr int Id = 1;
+	static constexpr const char* Name = "morton";
+
+	static size_t term(int axis, int c, glm::ivec3 const& dims)
+	{
+		assert((dims.x & (dims.x - 1)) == 0 && (dims.y & (dims.y - 1)) == 0 && (dims.z & (dims.z - 1)) == 0);
+		size_t res = 0;
+		int bit = 0;
+		for (int level = 0; (1 << level) < dims.x || (1 << level) < dims.y || (1 << level) < dims.z; ++level)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				if ((1 << level) >= dims[a])
+					continue;
+				if (a == axis)
+					res |= size_t((c >> level) & 1) << bit;
+				++bit;
+			}
+		}
+		return res;
+	}
+
+	static glm::ivec3 coords(size_t index, glm::ivec3 const& dims)
+	{
+		glm::ivec3 res = { 0, 0, 0 };
+		int bit = 0;
+		for (int level = 0; (1 << level) < dims.x || (1 << level) < dims.y || (1 << level) < dims.z; ++level)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				if ((1 << level) >= dims[a])
+					continue;
+				res[a] |= int((index >> bit) & 1) << level;
+				++bit;
+			}
+		}
+		return res;
+	}
+};
+
+// Bricks of 4x4x4 voxels, linear inside a brick and between the bricks (z fastest).
+// The dimensions must be multiples of 4.
+struct BrickedLayout
+{
+	static constexpr int Id = 2;
+	static constexpr const char* Name = "bricked";
+
+	static constexpr int BrickSize = 4;
+
+	static size_t term(int axis, int c, glm::ivec3 const& dims)
+	{
+		assert(dims.x % BrickSize == 0 && dims.y % BrickSize == 0 && dims.z % BrickSize == 0);
+		constexpr size_t brick_voxels = BrickSize * BrickSize * BrickSize;
+		const glm::ivec3 bricks = dims / BrickSize;
+		const size_t brick = c / BrickSize;
+		const size_t in_brick = c % BrickSize;
+		if (axis == 0)
+			return brick * bricks.y * bricks.z * brick_voxels + in_brick * BrickSize * BrickSize;
+		if (axis == 1)
+			return brick * bricks.z * brick_voxels + in_brick * BrickSize;
+		return brick * brick_voxels + in_brick;
+	}
+
+	static glm::ivec3 coords(size_t index, glm::ivec3 const& dims)
+	{
+		constexpr size_t brick_voxels = BrickSize * BrickSize * BrickSize;
+		const glm::ivec3 bricks = dims / BrickSize;
+		const size_t brick = index / brick_voxels;
+		const size_t in_brick = index % brick_voxels;
+		return {
+			int(brick / (size_t(bricks.y) * bricks.z)) * BrickSize + int(in_brick / (BrickSize * BrickSize)),
+			int((brick / bricks.z) % bricks.y) * BrickSize + int((in_brick / BrickSize) % BrickSize),
+			int(brick % bricks.z) * BrickSize + int(in_brick % BrickSize),
+		};
+	}
+};
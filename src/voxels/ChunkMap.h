@@ -0,0 +1,327 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+#include <functional>
+
+// Well mixed hash of a chunk id (splitmix64 finalizer on the packed coordinates)
+inline uint64_t hashChunkId(glm::ivec2 const& cid)
+{
+	uint64_t h = (uint64_t(uint32_t(cid.x)) << 32) | uint64_t(uint32_t(cid.y));
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+template <>
+struct std::hash<glm::ivec2>
+{
+	size_t operator()(glm::ivec2 const& cid) const noexcept
+	{
+		return size_t(hashChunkId(cid));
+	}
+};
+
+// Refers to a slot of a ChunkMap, stays valid (and keeps pointing to the same chunk) until the chunk is erased
+struct ChunkHandle
+{
+	static constexpr uint32_t InvalidIndex = ~uint32_t(0);
+
+	uint32_t index = InvalidIndex;
+	uint32_t generation = 0;
+
+	bool valid()const
+	{
+		return index != InvalidIndex;
+	}
+
+	bool operator==(ChunkHandle const&)const = default;
+};
+
+// Open addressing (linear probing) table of chunk ids to values of T.
+// The values are stored in slots that never move (a deque), so the references and the handles are stable.
+// Each slot also links its 4 horizontal neighbours, making the neighbour lookup a single indirection.
+template <class T>
+class ChunkMap
+{
+public:
+
+	// +x, -x, +z, -z (the y of a chunk id is the z of the world)
+	static constexpr int NeighbourCount = 4;
+
+	static glm::ivec2 neighbourOffset(int n)
+	{
+		constexpr int offsets[NeighbourCount][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+		return { offsets[n][0], offsets[n][1] };
+	}
+
+	static int opposite(int n)
+	{
+		return n ^ 1;
+	}
+
+protected:
+
+	static constexpr uint32_t Empty = ChunkHandle::InvalidIndex;
+	// max load = MaxLoadNum / MaxLoadDen
+	static constexpr size_t MaxLoadNum = 1, MaxLoadDen = 2;
+
+	struct Bucket
+	{
+		glm::ivec2 id;
+		uint32_t slot = Empty;
+	};
+
+	struct Slot
+	{
+		glm::ivec2 id;
+		std::optional<T> value;
+		uint32_t generation = 0;
+		uint32_t neighbours[NeighbourCount];
+	};
+
+	std::vector<Bucket> _table;
+	std::deque<Slot> _slots;
+	std::vector<uint32_t> _free_slots;
+	size_t _size = 0;
+
+	size_t mask()const
+	{
+		return _table.size() - 1;
+	}
+
+	// Bucket of id, or the empty bucket where it would be inserted
+	size_t probe(glm::ivec2 const& id)const
+	{
+		size_t b = hashChunkId(id) & mask();
+		while (_table[b].slot != Empty && _table[b].id != id)
+			b = (b + 1) & mask();
+		return b;
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<Bucket> old = std::move(_table);
+		_table = std::vector<Bucket>(capacity);
+		for (Bucket const& bucket : old)
+		{
+			if (bucket.slot != Empty)
+				_table[probe(bucket.id)] = bucket;
+		}
+	}
+
+	uint32_t findSlot(glm::ivec2 const& id)const
+	{
+		if (_table.empty())
+			return Empty;
+		return _table[probe(id)].slot;
+	}
+
+	ChunkHandle handleOf(uint32_t slot)const
+	{
+		if (slot == Empty)
+			return {};
+		return { slot, _slots[slot].generation };
+	}
+
+	// Backward shift deletion, keeps the probe sequences without tombstones
+	void eraseBucket(size_t b)
+	{
+		size_t hole = b;
+		size_t next = (b + 1) & mask();
+		while (_table[next].slot != Empty)
+		{
+			const size_t home = hashChunkId(_table[next].id) & mask();
+			// Can the bucket at next be moved to the hole (is the hole in [home, next) cyclically)?
+			if (((next - home) & mask()) >= ((next - hole) & mask()))
+			{
+				_table[hole] = _table[next];
+				hole = next;
+			}
+			next = (next + 1) & mask();
+		}
+		_table[hole].slot = Empty;
+	}
+
+public:
+
+	size_t size()const
+	{
+		return _size;
+	}
+
+	bool empty()const
+	{
+		return _size == 0;
+	}
+
+	size_t capacity()const
+	{
+		return _table.size();
+	}
+
+	void reserve(size_t n)
+	{
+		size_t capacity = 16;
+		while (capacity * MaxLoadNum < n * MaxLoadDen)
+			capacity *= 2;
+		if (capacity > _table.size())
+			rehash(capacity);
+	}
+
+	ChunkHandle find(glm::ivec2 const& id)const
+	{
+		return handleOf(findSlot(id));
+	}
+
+	bool contains(glm::ivec2 const& id)const
+	{
+		return findSlot(id) != Empty;
+	}
+
+	bool isValid(ChunkHandle h)const
+	{
+		return h.valid() && h.index < _slots.size() && _slots[h.index].generation == h.generation && _slots[h.index].value;
+	}
+
+	T* get(glm::ivec2 const& id)
+	{
+		const uint32_t slot = findSlot(id);
+		return slot == Empty ? nullptr : &*_slots[slot].value;
+	}
+
+	const T* get(glm::ivec2 const& id)const
+	{
+		const uint32_t slot = findSlot(id);
+		return slot == Empty ? nullptr : &*_slots[slot].value;
+	}
+
+	T& operator[](ChunkHandle h)
+	{
+		assert(isValid(h));
+		return *_slots[h.index].value;
+	}
+
+	T const& operator[](ChunkHandle h)const
+	{
+		assert(isValid(h));
+		return *_slots[h.index].value;
+	}
+
+	glm::ivec2 id(ChunkHandle h)const
+	{
+		assert(isValid(h));
+		return _slots[h.index].id;
+	}
+
+	// Invalid handle if the neighbour is not in the map
+	ChunkHandle neighbour(ChunkHandle h, int n)const
+	{
+		assert(isValid(h));
+		return handleOf(_slots[h.index].neighbours[n]);
+	}
+
+	// Does nothing if id is already in the map, returns the handle of id and whether it was inserted
+	std::pair<ChunkHandle, bool> insert(glm::ivec2 const& id, T&& value)
+	{
+		if ((_size + 1) * MaxLoadDen > _table.size() * MaxLoadNum)
+			reserve(std::max<size_t>(_size + 1, _table.size()));
+		const size_t b = probe(id);
+		if (_table[b].slot != Empty)
+			return { handleOf(_table[b].slot), false };
+
+		uint32_t slot;
+		if (_free_slots.empty())
+		{
+			slot = uint32_t(_slots.size());
+			_slots.emplace_back();
+		}
+		else
+		{
+			slot = _free_slots.back();
+			_free_slots.pop_back();
+		}
+		Slot& s = _slots[slot];
+		s.id = id;
+		s.value.emplace(std::move(value));
+		_table[b] = { id, slot };
+		++_size;
+
+		for (int n = 0; n < NeighbourCount; ++n)
+		{
+			const uint32_t other = findSlot(id + neighbourOffset(n));
+			s.neighbours[n] = other;
+			if (other != Empty)
+				_slots[other].neighbours[opposite(n)] = slot;
+		}
+		return { handleOf(slot), true };
+	}
+
+	bool erase(glm::ivec2 const& id)
+	{
+		if (_table.empty())
+			return false;
+		const size_t b = probe(id);
+		const uint32_t slot = _table[b].slot;
+		if (slot == Empty)
+			return false;
+		eraseBucket(b);
+
+		Slot& s = _slots[slot];
+		for (int n = 0; n < NeighbourCount; ++n)
+		{
+			if (s.neighbours[n] != Empty)
+				_slots[s.neighbours[n]].neighbours[opposite(n)] = Empty;
+		}
+		s.value.reset();
+		++s.generation;
+		_free_slots.push_back(slot);
+		--_size;
+		return true;
+	}
+
+	bool erase(ChunkHandle h)
+	{
+		return isValid(h) && erase(_slots[h.index].id);
+	}
+
+	void clear()
+	{
+		_table.clear();
+		_slots.clear();
+		_free_slots.clear();
+		_size = 0;
+	}
+
+	// f(ChunkHandle, glm::ivec2 id, T& value), in slot order
+	template <class Func>
+	void forEach(Func const& f)
+	{
+		for (uint32_t i = 0; i < _slots.size(); ++i)
+		{
+			Slot& s = _slots[i];
+			if (s.value)
+				f(ChunkHandle{ i, s.generation }, s.id, *s.value);
+		}
+	}
+
+	template <class Func>
+	void forEach(Func const& f)const
+	{
+		for (uint32_t i = 0; i < _slots.size(); ++i)
+		{
+			const Slot& s = _slots[i];
+			if (s.value)
+				f(ChunkHandle{ i, s.generation }, s.id, *s.value);
+		}
+	}
+};
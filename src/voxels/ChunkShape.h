@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <bit>
+#include <cassert>
+#include <voxels/SlabAllocator.h>
+
+// Dimensions of a chunk (see BasicChunk), its base class.
+// Buffer<T, N> is what the chunk keeps its fixed size arrays in (N is only used by the fixed shapes).
+
+// Dimensions given at run time
+class DynamicShape
+{
+public:
+
+	static constexpr bool Fixed = false;
+
+	static constexpr int SizeX = 0, SizeY = 0, SizeZ = 0;
+
+	template <class T, size_t N>
+	using Buffer = std::vector<T>;
+
+protected:
+
+	glm::ivec3 _dims;
+
+public:
+
+	DynamicShape(glm::ivec3 const& dims) :
+		_dims(dims)
+	{}
+
+	glm::ivec3 dims()const
+	{
+		return _dims;
+	}
+};
+
+// Dimensions known at compile time, powers of two, so that the index math folds into shifts
+// and the buffers of a chunk come from the SlabAllocator of their size.
+template <int X, int Y, int Z>
+class FixedShape
+{
+public:
+
+	static_assert(std::has_single_bit(unsigned(X)) && std::has_single_bit(unsigned(Y)) && std::has_single_bit(unsigned(Z)));
+
+	static constexpr bool Fixed = true;
+
+	static constexpr int SizeX = X, SizeY = Y, SizeZ = Z;
+
+	template <class T, size_t N>
+	using Buffer = SlabArray<T, N>;
+
+	FixedShape(glm::ivec3 const& dims)
+	{
+		assert(dims == glm::ivec3(X, Y, Z));
+	}
+
+	static glm::ivec3 dims()
+	{
+		return { X, Y, Z };
+	}
+};
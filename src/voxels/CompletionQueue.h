@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Lock-free multiple producers / single consumer queue.
+// Producers (worker threads) push with a CAS on the head of an intrusive list,
+// the consumer (the GL thread) takes the whole list at once and walks it in push order.
+template <class T>
+class CompletionQueue
+{
+protected:
+
+	struct Node
+	{
+		T value;
+		Node* next;
+	};
+
+	std::atomic<Node*> _head;
+
+	static Node* reverse(Node* list)
+	{
+		Node* res = nullptr;
+		while (list)
+		{
+			Node* next = list->next;
+			list->next = res;
+			res = list;
+			list = next;
+		}
+		return res;
+	}
+
+public:
+
+	CompletionQueue():
+		_head(nullptr)
+	{}
+
+	CompletionQueue(CompletionQueue const&) = delete;
+
+	~CompletionQueue()
+	{
+		consumeAll([](T&&) {});
+	}
+
+	void push(T&& value)
+	{
+		Node* node = new Node{ std::move(value), _head.load(std::memory_order_relaxed) };
+		while (!_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	bool empty()const
+	{
+		return _head.load(std::memory_order_relaxed) == nullptr;
+	}
+
+	// f(T&&), returns the number of consumed elements
+	template <class Func>
+	size_t consumeAll(Func const& f)
+	{
+		Node* list = reverse(_head.exchange(nullptr, std::memory_order_acquire));
+		size_t res = 0;
+		while (list)
+		{
+			Node* next = list->next;
+			f(std::move(list->value));
+			delete list;
+			list = next;
+			++res;
+		}
+		return res;
+	}
+};
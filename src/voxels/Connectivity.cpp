@@ -0,0 +1,80 @@
+#include <voxels/Connectivity.h>
+#include <algorithm>
+
+void ChunkConnectivity::build(Chunk const& chunk, OpaqueTable const& opaque)
+{
+	_sections.resize(chunk.sectionCount());
+	for (int s = 0; s < chunk.sectionCount(); ++s)
+		buildSection(chunk, s, opaque);
+}
+
+void ChunkConnectivity::buildSection(Chunk const& chunk, int s, OpaqueTable const& opaque)
+{
+	_sections.resize(chunk.sectionCount());
+	const auto isOpaque = [&opaque](Voxel v)
+	{
+		return uint32_t(v.id) < opaque.size() ? opaque[v.id] : true;
+	};
+
+	// Decided by the palette alone when its values are all opaque or all open
+	const PaletteStorage& section = chunk.section(s);
+	bool all_opaque = true, all_open = true;
+	for (Voxel v : section.palette())
+	{
+		const bool o = isOpaque(v);
+		all_opaque = all_opaque && o;
+		all_open = all_open && !o;
+	}
+	if (all_opaque || all_open)
+	{
+		_sections[s] = SectionConnectivity(all_open ? SectionConnectivity::AllPairs : 0);
+		return;
+	}
+
+	// Cells indexed (x * SectionHeight + y) * dims.z + z, 1 -> open and not reached yet
+	const glm::ivec3 dims = chunk.sectionDims();
+	thread_local std::vector<uint8_t> open;
+	thread_local std::vector<int> stack;
+	open.resize(chunk.sectionSize());
+	for (int x = 0; x < dims.x; ++x)
+		for (int y = 0; y < dims.y; ++y)
+			for (int z = 0; z < dims.z; ++z)
+				open[(size_t(x) * dims.y + y) * dims.z + z] = !isOpaque(section.get(chunk.localId(x, y, z)));
+
+	SectionConnectivity res;
+	const int strides[3] = { dims.y * dims.z, dims.z, 1 };
+	for (size_t seed = 0; seed < open.size() && res.pairs() != SectionConnectivity::AllPairs; ++seed)
+	{
+		if (!open[seed])
+			continue;
+		// Faces of the section touched by the component of seed
+		uint32_t faces = 0;
+		open[seed] = 0;
+		stack.assign(1, int(seed));
+		while (!stack.empty())
+		{
+			const int c = stack.back();
+			stack.pop_back();
+			const int p[3] = { c / strides[0], (c / strides[1]) % dims.y, c % dims.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (p[axis] == dims[axis] - 1)
+					faces |= 1u << (axis * 2);
+				else if (open[c + strides[axis]])
+				{
+					open[c + strides[axis]] = 0;
+					stack.push_back(c + strides[axis]);
+				}
+				if (p[axis] == 0)
+					faces |= 1u << (axis * 2 + 1);
+				else if (open[c - strides[axis]])
+				{
+					open[c - strides[axis]] = 0;
+					stack.push_back(c - strides[axis]);
+				}
+			}
+		}
+		res.connectAll(faces);
+	}
+	_sections[s] = res;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <voxels/Chunk.h>
+
+// Which faces of a section see each other through its cells that are not opaque (cave culling).
+// Faces are axis * 2 + s (s: 0 -> +, 1 -> -) as in FaceStream, one bit per pair of distinct faces.
+class SectionConnectivity
+{
+public:
+
+	static constexpr int Faces = 6;
+
+	static constexpr uint16_t AllPairs = (1u << 15) - 1;
+
+protected:
+
+	uint16_t _pairs;
+
+	static int pairBit(int a, int b)
+	{
+		if (a > b)
+			std::swap(a, b);
+		return a * (11 - a) / 2 + (b - a - 1);
+	}
+
+public:
+
+	SectionConnectivity(uint16_t pairs = 0) :
+		_pairs(pairs)
+	{}
+
+	bool connected(int a, int b)const
+	{
+		return a != b && ((_pairs >> pairBit(a, b)) & 1u);
+	}
+
+	void connect(int a, int b)
+	{
+		if (a != b)
+			_pairs |= uint16_t(1u << pairBit(a, b));
+	}
+
+	// Connects all the faces of the mask (bit f -> face f) with each other
+	void connectAll(uint32_t faces)
+	{
+		for (int a = 0; a < Faces; ++a)
+			for (int b = a + 1; b < Faces; ++b)
+				if ((faces >> a) & (faces >> b) & 1u)
+					connect(a, b);
+	}
+
+	uint16_t pairs()const
+	{
+		return _pairs;
+	}
+};
+
+// Connectivity of all the sections of a chunk, built by flood filling the cells that are not opaque in each section.
+// Built by the workers with the chunk, read by the visibility search of World.
+class ChunkConnectivity
+{
+protected:
+
+	std::vector<SectionConnectivity> _sections;
+
+public:
+
+	void build(Chunk const& chunk, OpaqueTable const& opaque);
+
+	// Rebuilds the section s only
+	void buildSection(Chunk const& chunk, int s, OpaqueTable const& opaque);
+
+	int sectionCount()const
+	{
+		return int(_sections.size());
+	}
+
+	SectionConnectivity section(int s)const
+	{
+		return _sections[s];
+	}
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Set of [begin, end) ranges of an array that need to be re-uploaded.
+// Consecutive adds are merged on the fly, past MaxRanges everything is considered dirty.
+class DirtyRanges
+{
+public:
+
+	struct Range
+	{
+		size_t begin, end;
+	};
+
+	static constexpr size_t MaxRanges = 256;
+
+protected:
+
+	std::vector<Range> _ranges;
+	bool _all;
+
+public:
+
+	DirtyRanges() :
+		_all(false)
+	{}
+
+	void add(size_t begin, size_t end)
+	{
+		if (_all)	return;
+		if (!_ranges.empty())
+		{
+			Range& last = _ranges.back();
+			if (begin <= last.end && end >= last.begin)
+			{
+				last.begin = std::min(last.begin, begin);
+				last.end = std::max(last.end, end);
+				return;
+			}
+		}
+		if (_ranges.size() == MaxRanges)
+			markAll();
+		else
+			_ranges.push_back({ begin, end });
+	}
+
+	void add(size_t i)
+	{
+		add(i, i + 1);
+	}
+
+	void markAll()
+	{
+		_all = true;
+		_ranges.clear();
+	}
+
+	void clear()
+	{
+		_all = false;
+		_ranges.clear();
+	}
+
+	bool all()const
+	{
+		return _all;
+	}
+
+	bool empty()const
+	{
+		return !_all && _ranges.empty();
+	}
+
+	// Sorts and merges the ranges separated by less than max_gap elements
+	// (uploading a few clean elements is cheaper than an extra call)
+	std::vector<Range> const& coalesce(size_t max_gap)
+	{
+		if (_ranges.size() > 1)
+		{
+			std::sort(_ranges.begin(), _ranges.end(), [](Range const& a, Range const& b) {return a.begin < b.begin; });
+			size_t n = 0;
+			for (size_t i = 1; i < _ranges.size(); ++i)
+			{
+				if (_ranges[i].begin <= _ranges[n].end + max_gap)
+					_ranges[n].end = std::max(_ranges[n].end, _ranges[i].end);
+				else
+					_ranges[++n] = _ranges[i];
+			}
+			_ranges.resize(n + 1);
+		}
+		return _ranges;
+	}
+};
@@ -0,0 +1,329 @@
+#include <voxels/FaceStream.h>
+#include <algorithm>
+#include <bit>
+
+ChunkFaces::ChunkFaces():
+	_offsets{},
+	_arena(nullptr)
+{}
+
+ChunkFaces::ChunkFaces(ChunkFaces&& other) :
+	_faces(std::move(other._faces)),
+	_offsets(other._offsets),
+	_arena(other._arena),
+	_range(other._range)
+{
+	other._arena = nullptr;
+	other._range = {};
+}
+
+ChunkFaces::~ChunkFaces()
+{
+	deleteBuffer();
+}
+
+ChunkFaces& ChunkFaces::operator=(ChunkFaces&& other)
+{
+	deleteBuffer();
+	_faces = std::move(other._faces);
+	_offsets = other._offsets;
+	_arena = other._arena;
+	_range = other._range;
+	other._arena = nullptr;
+	other._range = {};
+	return *this;
+}
+
+void ChunkFaces::clear()
+{
+	_faces.clear();
+	_offsets.fill(0);
+}
+
+uint32_t ChunkFaces::pack(glm::ivec3 const& pos, int face, int tex)
+{
+	assert(pos.x < MaxDims.x && pos.y < MaxDims.y && pos.z < MaxDims.z);
+	assert(face < Directions && tex < 256);
+	return uint32_t(pos.x) | (uint32_t(pos.y) << 5) | (uint32_t(pos.z) << 13) | (uint32_t(face) << 18) | (uint32_t(tex) << 21);
+}
+
+void ChunkFaces::addFace(glm::ivec3 const& pos, int face, int tex, uint32_t light)
+{
+	_faces.push_back(pack(pos, face, tex));
+	_faces.push_back(light);
+	for (int d = face + 1; d <= Directions; ++d)
+		_offsets[d] = uint32_t(faceCount());
+}
+
+size_t ChunkFaces::faceCount()const
+{
+	return _faces.size() / FaceWords;
+}
+
+size_t ChunkFaces::faceCount(int face)const
+{
+	return _offsets[face + 1] - _offsets[face];
+}
+
+size_t ChunkFaces::triangleCount()const
+{
+	return faceCount() * 2;
+}
+
+size_t ChunkFaces::byteSize()const
+{
+	return _faces.size() * sizeof(uint32_t);
+}
+
+size_t ChunkFaces::deviceMemoryUsage()const
+{
+	return _range.size;
+}
+
+void ChunkFaces::upload(BufferArena& arena)
+{
+	if (_arena && (byteSize() > _range.size || &arena != _arena))
+		deleteBuffer();
+	if (_arena == nullptr)
+	{
+		_arena = &arena;
+		_range = _arena->allocate(byteSize());
+	}
+	_arena->upload(_range, _faces.data(), byteSize());
+}
+
+void ChunkFaces::deleteBuffer()
+{
+	if (_arena)
+		_arena->release(_range);
+	_arena = nullptr;
+	_range = {};
+}
+
+bool ChunkFaces::uploaded()const
+{
+	return _arena != nullptr;
+}
+
+GLuint ChunkFaces::firstFace()const
+{
+	return GLuint(_range.offset / (FaceWords * sizeof(uint32_t)));
+}
+
+size_t ChunkFaces::draw(uint32_t face_mask)const
+{
+	// One draw per run of consecutive directions, gl_BaseInstance gives the first face to the shader
+	thread_local std::vector<DrawCommand> commands;
+	commands.clear();
+	appendDraws(face_mask, commands);
+	for (DrawCommand const& command : commands)
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, command.first, command.count, command.instance_count, command.base_instance);
+	return commands.size();
+}
+
+size_t ChunkFaces::appendDraws(uint32_t face_mask, std::vector<DrawCommand>& commands)const
+{
+	assert(uploaded());
+	const size_t n = commands.size();
+	for (int d = 0; d < Directions;)
+	{
+		if (!(face_mask & (1u << d)))
+		{
+			++d;
+			continue;
+		}
+		int e = d + 1;
+		while (e < Directions && (face_mask & (1u << e)))
+			++e;
+		const GLuint count = _offsets[e] - _offsets[d];
+		if (count)
+			commands.push_back(DrawCommand{ 4, count, 0, firstFace() + _offsets[d] });
+		d = e;
+	}
+	return commands.size() - n;
+}
+
+
+
+FaceBuilder::FaceBuilder(std::vector<Property> const& properties):
+	_opaque(makeOpaqueTable(properties))
+{
+	_all_opaque = std::all_of(_opaque.begin() + 1, _opaque.end(), [](bool b) {return b; });
+	for (size_t i = 0; i < _textures.size(); ++i)
+	{
+		for (int f = 0; f < ChunkFaces::Directions; ++f)
+			_textures[i][f] = i < properties.size() ? uint8_t(std::clamp(properties[i].face_ids[f], 0, 255)) : 0;
+	}
+}
+
+size_t FaceBuilder::build(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron, LightVolume const* light)const
+{
+	res.clear();
+	return _all_opaque ? buildFromOccupancy(chunk, res, apron, light) : buildPerVoxel(chunk, res, apron, light);
+}
+
+uint32_t FaceBuilder::faceLight(LightVolume const& light, glm::ivec3 const& pos, int face)
+{
+	const int axis = face / 2;
+	const int u_axis = (axis + 1) % 3;
+	const int v_axis = (axis + 2) % 3;
+	glm::ivec3 front = pos;
+	front[axis] += face % 2 == 0 ? 1 : -1;
+	uint32_t res = light.light(front.x, front.y, front.z);
+	// Occlusion of the corners by the cells around the front one, in its plane
+	const auto opaque = [&](int du, int dv)
+	{
+		glm::ivec3 p = front;
+		p[u_axis] += du;
+		p[v_axis] += dv;
+		return int(light.opaque(p.x, p.y, p.z));
+	};
+	for (int cv = 0; cv < 2; ++cv)
+	{
+		for (int cu = 0; cu < 2; ++cu)
+		{
+			const int du = cu ? 1 : -1, dv = cv ? 1 : -1;
+			const int side_u = opaque(du, 0), side_v = opaque(0, dv);
+			const int ao = side_u && side_v ? 0 : 3 - (side_u + side_v + opaque(du, dv));
+			res |= uint32_t(ao) << (8 + 2 * (cu + 2 * cv));
+		}
+	}
+	return res;
+}
+
+size_t FaceBuilder::buildFromOccupancy(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron, LightVolume const* light)const
+{
+	size_t culled = 0;
+	const glm::ivec3 dims = chunk.dims();
+	assert(dims.x <= ChunkFaces::MaxDims.x && dims.y <= ChunkFaces::MaxDims.y && dims.z <= ChunkFaces::MaxDims.z);
+	const int words = chunk.columnWords();
+
+	// Occupancy columns with a border of one column, filled from the apron: [((x + 1) * (dims.z + 2) + z + 1) * words]
+	const int pz = dims.z + 2;
+	thread_local std::vector<uint64_t> occupancy;
+	occupancy.assign(size_t(dims.x + 2) * pz * words, 0);
+	const auto column = [&](int x, int z)
+	{
+		return occupancy.data() + (size_t(x + 1) * pz + (z + 1)) * words;
+	};
+	for (int x = 0; x < dims.x; ++x)
+		for (int z = 0; z < dims.z; ++z)
+			std::copy_n(chunk.occupancyColumn(x, z), words, column(x, z));
+	if (apron)
+	{
+		for (int n = 0; n < ChunkApron::Sides; ++n)
+		{
+			const int length = n < 2 ? dims.z : dims.x;
+			for (int u = 0; u < length; ++u)
+			{
+				uint64_t* border = n == 0 ? column(dims.x, u) : n == 1 ? column(-1, u) : n == 2 ? column(u, dims.z) : column(u, -1);
+				for (int y = 0; y < dims.y; ++y)
+				{
+					if (apron->opaque(n, y, u))
+						border[y / Chunk::ColumnWordBits] |= uint64_t(1) << (y % Chunk::ColumnWordBits);
+				}
+			}
+		}
+	}
+
+	const auto emit = [&](int x, int z, int w, uint64_t visible, int face)
+	{
+		while (visible)
+		{
+			const int y = w * Chunk::ColumnWordBits + std::countr_zero(visible);
+			visible &= visible - 1;
+			const glm::ivec3 p = { x, y, z };
+			const int32_t id = chunk(p).id;
+			res.addFace(p, face, uint32_t(id) < _textures.size() ? _textures[id][face] : 0, light ? faceLight(*light, p, face) : ChunkFaces::FullLight);
+		}
+	};
+
+	for (int face = 0; face < ChunkFaces::Directions; ++face)
+	{
+		const int axis = face / 2;
+		const int front = face % 2 == 0 ? 1 : -1;
+		for (int x = 0; x < dims.x; ++x)
+		{
+			for (int z = 0; z < dims.z; ++z)
+			{
+				const uint64_t* occ = column(x, z);
+				if (axis == 1)
+				{
+					// The front voxel of y is in the same column, at y + front
+					for (int w = 0; w < words; ++w)
+					{
+						uint64_t front_occ;
+						if (front > 0)
+							front_occ = (occ[w] >> 1) | (w + 1 < words ? occ[w + 1] << (Chunk::ColumnWordBits - 1) : 0);
+						else
+							front_occ = (occ[w] << 1) | (w > 0 ? occ[w - 1] >> (Chunk::ColumnWordBits - 1) : 0);
+						emit(x, z, w, occ[w] & ~front_occ, face);
+					}
+				}
+				else
+				{
+					const int fx = axis == 0 ? x + front : x;
+					const int fz = axis == 2 ? z + front : z;
+					const bool border = fx < 0 || fx >= dims.x || fz < 0 || fz >= dims.z;
+					const uint64_t* front_occ = column(fx, fz);
+					for (int w = 0; w < words; ++w)
+					{
+						if (border)
+							culled += std::popcount(occ[w] & front_occ[w]);
+						emit(x, z, w, occ[w] & ~front_occ[w], face);
+					}
+				}
+			}
+		}
+	}
+	return culled;
+}
+
+size_t FaceBuilder::buildPerVoxel(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron, LightVolume const* light)const
+{
+	size_t culled = 0;
+	const glm::ivec3 dims = chunk.dims();
+	assert(dims.x <= ChunkFaces::MaxDims.x && dims.y <= ChunkFaces::MaxDims.y && dims.z <= ChunkFaces::MaxDims.z);
+	// Linear layout, z fastest
+	const glm::ivec3 strides = { dims.y * dims.z, dims.z, 1 };
+
+	thread_local std::vector<int32_t> ids;
+	ids.resize(chunk.size());
+	chunk.decode(ids.data());
+
+	for (int face = 0; face < ChunkFaces::Directions; ++face)
+	{
+		const int axis = face / 2;
+		const int front = face % 2 == 0 ? 1 : -1;
+		const int front_stride = front * strides[axis];
+		const int apron_side = apron ? ChunkApron::side(axis, face % 2) : -1;
+		glm::ivec3 p;
+		for (p.x = 0; p.x < dims.x; ++p.x)
+		{
+			for (p.y = 0; p.y < dims.y; ++p.y)
+			{
+				const int32_t* row = ids.data() + size_t(p.x) * strides.x + size_t(p.y) * strides.y;
+				for (p.z = 0; p.z < dims.z; ++p.z)
+				{
+					const int32_t id = row[p.z];
+					if (id == 0)
+						continue;
+					const int front_pos = p[axis] + front;
+					if (front_pos >= 0 && front_pos < dims[axis])
+					{
+						const int32_t front_id = row[p.z + front_stride];
+						if (uint32_t(front_id) >= _opaque.size() || _opaque[front_id])
+							continue;
+					}
+					else if (apron_side >= 0 && apron->opaque(apron_side, p.y, axis == 0 ? p.z : p.x))
+					{
+						++culled;
+						continue;
+					}
+					res.addFace(p, face, uint32_t(id) < _textures.size() ? _textures[id][face] : 0, light ? faceLight(*light, p, face) : ChunkFaces::FullLight);
+				}
+			}
+		}
+	}
+	return culled;
+}
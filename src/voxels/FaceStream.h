@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+#include <voxels/BufferArena.h>
+#include <voxels/ChunkApron.h>
+#include <voxels/Light.h>
+
+// Visible faces of a chunk, two 32 bits words each, drawn as instanced quads by vertex pulling (see voxel_faces.vert):
+// x (5 bits) | y (8 bits) | z (5 bits) | face (3 bits) | texture layer (8 bits)
+// block light (4 bits) | sky light (4 bits) | ambient occlusion (2 bits per corner (u, v), at 8 + 2 * (u + 2 * v))
+// face = axis * 2 + s (s: 0 -> +, 1 -> -), u = (axis + 1) % 3, v = (axis + 2) % 3. The light is the one of the front
+// cell of the face, the occlusion of a corner goes from 0 (dark) to 3. The faces are grouped by direction, so that a whole direction
+// facing away from the camera can be skipped for a chunk.
+// The faces of all the chunks share one BufferArena: a chunk is drawn from its range of the arena, on its own
+// with draw() or as commands of a single multi draw for all the chunks with appendDraws().
+class ChunkFaces
+{
+public:
+
+	static constexpr int Directions = 6;
+
+	static constexpr glm::ivec3 MaxDims = { 32, 256, 32 };
+
+	static constexpr int FaceWords = 2;
+
+	// Full sky light, no block light nor occlusion: the light of the faces built without a light volume
+	static constexpr uint32_t FullLight = (LightMargin::MaxLight << 4) | (0xffu << 8);
+
+	using DrawCommand = BufferArena::DrawCommand;
+
+protected:
+
+	// FaceWords per face
+	std::vector<uint32_t> _faces;
+	// faces of the direction d: [_offsets[d], _offsets[d + 1])
+	std::array<uint32_t, Directions + 1> _offsets;
+	BufferArena* _arena;
+	BufferArena::Range _range;
+
+public:
+
+	ChunkFaces();
+
+	ChunkFaces(ChunkFaces const&) = delete;
+
+	ChunkFaces(ChunkFaces&& other);
+
+	~ChunkFaces();
+
+	ChunkFaces& operator=(ChunkFaces&& other);
+
+	void clear();
+
+	static uint32_t pack(glm::ivec3 const& pos, int face, int tex);
+
+	// Faces must be added direction by direction, in the order of the directions
+	void addFace(glm::ivec3 const& pos, int face, int tex, uint32_t light = FullLight);
+
+	size_t faceCount()const;
+
+	size_t faceCount(int face)const;
+
+	size_t triangleCount()const;
+
+	size_t byteSize()const;
+
+	size_t deviceMemoryUsage()const;
+
+	// GL thread only, the faces are written to a range of arena (given back by deleteBuffer)
+	void upload(BufferArena& arena);
+
+	void deleteBuffer();
+
+	bool uploaded()const;
+
+	// Index of the first face in the arena
+	GLuint firstFace()const;
+
+	// Draws the faces of the directions set in face_mask (bit face), the arena must be bound to the faces binding.
+	// Returns the number of draw calls.
+	size_t draw(uint32_t face_mask = 0x3f)const;
+
+	// Appends the commands drawing the faces of the directions set in face_mask, returns the number of commands
+	size_t appendDraws(uint32_t face_mask, std::vector<DrawCommand>& commands)const;
+};
+
+// Emits every face of a non empty voxel whose front neighbour is not opaque,
+// the neighbours out of the chunk are read from the apron if given, considered transparent otherwise.
+// When every non empty block type is opaque, the occupancy of the chunk is the opacity: the visible faces are then
+// found 64 voxels at a time with shifts and masks on the occupancy columns, else voxel by voxel.
+// Thread safe: build() can be called from several workers at the same time.
+class FaceBuilder
+{
+protected:
+
+	OpaqueTable _opaque;
+	bool _all_opaque;
+	std::array<std::array<uint8_t, 6>, 256> _textures;
+
+	size_t buildFromOccupancy(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron, LightVolume const* light)const;
+
+	size_t buildPerVoxel(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron, LightVolume const* light)const;
+
+	// Second word of the face of the voxel at pos (see ChunkFaces)
+	static uint32_t faceLight(LightVolume const& light, glm::ivec3 const& pos, int face);
+
+public:
+
+	FaceBuilder(std::vector<Property> const& properties = {});
+
+	// The faces are lit from light if given (built for the chunk), fully sky lit otherwise.
+	// Returns the number of border faces culled thanks to the apron
+	size_t build(Chunk const& chunk, ChunkFaces& res, ChunkApron const* apron = nullptr, LightVolume const* light = nullptr)const;
+};
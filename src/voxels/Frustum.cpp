@@ -0,0 +1,138 @@
+#include <voxels/Frustum.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+Frustum Frustum::fromMatrix(glm::mat4 const& PV)
+{
+	// glm is column major: PV[c][r]
+	const auto row = [&PV](int r)
+	{
+		return glm::vec4(PV[0][r], PV[1][r], PV[2][r], PV[3][r]);
+	};
+	const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+	Frustum res;
+	res.planes[Left] = r3 + r0;
+	res.planes[Right] = r3 - r0;
+	res.planes[Bottom] = r3 + r1;
+	res.planes[Top] = r3 - r1;
+	res.planes[Near] = r3 + r2;
+	res.planes[Far] = r3 - r2;
+	return res;
+}
+
+Frustum Frustum::fromCamera(lib::Camera<float> const& cam)
+{
+	return fromMatrix(cam.getMatrixP() * cam.getMatrixV());
+}
+
+bool Frustum::intersects(glm::vec3 const& box_min, glm::vec3 const& box_max)const
+{
+	for (glm::vec4 const& plane : planes)
+	{
+		// Corner the furthest along the plane normal
+		const glm::vec3 p = {
+			plane.x > 0 ? box_max.x : box_min.x,
+			plane.y > 0 ? box_max.y : box_min.y,
+			plane.z > 0 ? box_max.z : box_min.z,
+		};
+		if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0)
+			return false;
+	}
+	return true;
+}
+
+void AABBList::clear()
+{
+	min_x.clear(); min_y.clear(); min_z.clear();
+	max_x.clear(); max_y.clear(); max_z.clear();
+}
+
+void AABBList::push_back(glm::vec3 const& box_min, glm::vec3 const& box_max)
+{
+	min_x.push_back(box_min.x); min_y.push_back(box_min.y); min_z.push_back(box_min.z);
+	max_x.push_back(box_max.x); max_y.push_back(box_max.y); max_z.push_back(box_max.z);
+}
+
+size_t AABBList::size()const
+{
+	return min_x.size();
+}
+
+size_t cullAABBs(Frustum const& frustum, AABBList const& boxes, std::vector<uint8_t>& visible)
+{
+	const size_t n = boxes.size();
+	visible.resize(n);
+
+	// The furthest corner only depends on the sign of the plane normal, select the arrays once per plane
+	const float* px[6], * py[6], * pz[6];
+	for (int i = 0; i < 6; ++i)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		px[i] = plane.x > 0 ? boxes.max_x.data() : boxes.min_x.data();
+		py[i] = plane.y > 0 ? boxes.max_y.data() : boxes.min_y.data();
+		pz[i] = plane.z > 0 ? boxes.max_z.data() : boxes.min_z.data();
+	}
+
+	size_t b = 0;
+	size_t res = 0;
+#if FRUSTUM_AVX
+	for (; b + 8 <= n; b += 8)
+	{
+		__m256 outside = _mm256_setzero_ps();
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = frustum.planes[i];
+			__m256 d = _mm256_set1_ps(plane.w);
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(px[i] + b)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(py[i] + b)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(pz[i] + b)));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+		const int mask = _mm256_movemask_ps(outside);
+		for (int j = 0; j < 8; ++j)
+		{
+			visible[b + j] = !(mask & (1 << j));
+			res += visible[b + j];
+		}
+	}
+#elif FRUSTUM_SSE
+	for (; b + 4 <= n; b += 4)
+	{
+		__m128 outside = _mm_setzero_ps();
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = frustum.planes[i];
+			__m128 d = _mm_set1_ps(plane.w);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(px[i] + b)));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(py[i] + b)));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(pz[i] + b)));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+		}
+		const int mask = _mm_movemask_ps(outside);
+		for (int j = 0; j < 4; ++j)
+		{
+			visible[b + j] = !(mask & (1 << j));
+			res += visible[b + j];
+		}
+	}
+#endif
+	// Remaining boxes (or everything without SIMD)
+	for (; b < n; ++b)
+	{
+		bool inside = true;
+		for (int i = 0; i < 6 && inside; ++i)
+		{
+			const glm::vec4& plane = frustum.planes[i];
+			inside = plane.x * px[i][b] + plane.y * py[i][b] + plane.z * pz[i][b] + plane.w >= 0;
+		}
+		visible[b] = inside;
+		res += inside;
+	}
+	return res;
+}
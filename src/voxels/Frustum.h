@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <lib/Camera.h>
+
+// 6 planes (a, b, c, d), a point p is inside the frustum if a*p.x + b*p.y + c*p.z + d >= 0 for all of them
+struct Frustum
+{
+	enum Plane { Left, Right, Bottom, Top, Near, Far };
+
+	glm::vec4 planes[6];
+
+	// Gribb-Hartmann extraction, PV maps the world to the GL clip space
+	static Frustum fromMatrix(glm::mat4 const& PV);
+
+	static Frustum fromCamera(lib::Camera<float> const& cam);
+
+	// Conservative: can keep a box that is outside near a corner of the frustum, never rejects a visible one
+	bool intersects(glm::vec3 const& box_min, glm::vec3 const& box_max)const;
+};
+
+// Boxes in structure of arrays layout for the batched tests
+struct AABBList
+{
+	std::vector<float> min_x, min_y, min_z;
+	std::vector<float> max_x, max_y, max_z;
+
+	void clear();
+
+	void push_back(glm::vec3 const& box_min, glm::vec3 const& box_max);
+
+	size_t size()const;
+};
+
+// visible[i] = boxes[i] intersects the frustum (same test as Frustum::intersects)
+// Tests 8 (AVX) or 4 (SSE) boxes at a time, returns the number of visible boxes
+size_t cullAABBs(Frustum const& frustum, AABBList const& boxes, std::vector<uint8_t>& visible);
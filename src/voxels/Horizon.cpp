@@ -0,0 +1,134 @@
+#include <voxels/Horizon.h>
+#include <algorithm>
+#include <limits>
+#include <numbers>
+#include <bit>
+#include <cmath>
+
+ChunkHeights ChunkHeights::compute(Chunk const& chunk, OpaqueTable const& opaque)
+{
+	const glm::ivec3 dims = chunk.dims();
+	const int words = chunk.columnWords();
+	ChunkHeights res{ dims.y, 0 };
+	for (int x = 0; x < dims.x; ++x)
+	{
+		for (int z = 0; z < dims.z; ++z)
+		{
+			const uint64_t* column = chunk.occupancyColumn(x, z);
+			// Occupied from the bottom
+			int w = 0;
+			while (w < words && column[w] == ~uint64_t(0))
+				++w;
+			const int solid = w * Chunk::ColumnWordBits + (w < words ? std::countr_one(column[w]) : 0);
+			res.ground = std::min(res.ground, solid);
+			for (w = words - 1; w >= 0; --w)
+			{
+				if (column[w])
+				{
+					res.top = std::max(res.top, (w + 1) * Chunk::ColumnWordBits - std::countl_zero(column[w]));
+					break;
+				}
+			}
+		}
+	}
+	res.ground = std::min(res.ground, dims.y);
+
+	// The occupancy does not tell the transparent values apart
+	for (int s = 0; s * Chunk::SectionHeight < res.ground; ++s)
+	{
+		for (Voxel v : chunk.section(s).palette())
+		{
+			if (v.id != 0 && uint32_t(v.id) < opaque.size() && !opaque[v.id])
+			{
+				res.ground = s * Chunk::SectionHeight;
+				return res;
+			}
+		}
+	}
+	return res;
+}
+
+HorizonBuffer::HorizonBuffer() :
+	_eye(0),
+	_slopes(Bins, -std::numeric_limits<float>::infinity())
+{}
+
+void HorizonBuffer::reset(glm::vec3 const& eye)
+{
+	_eye = eye;
+	std::fill(_slopes.begin(), _slopes.end(), -std::numeric_limits<float>::infinity());
+}
+
+bool HorizonBuffer::extent(glm::vec2 const& box_min, glm::vec2 const& box_max, float& a0, float& a1, float& d_min, float& d_max)const
+{
+	constexpr float pi = std::numbers::pi_v<float>;
+	const glm::vec2 eye = { _eye.x, _eye.z };
+	d_min = glm::distance(eye, glm::clamp(eye, box_min, box_max));
+	if (d_min == 0)
+		return false;
+
+	// Azimuths of the corners relative to the one of the center, the footprint does not contain the eye so they span less than pi
+	const glm::vec2 center = 0.5f * (box_min + box_max) - eye;
+	const float a_center = std::atan2(center.y, center.x);
+	float lo = 0, hi = 0;
+	d_max = 0;
+	for (int c = 0; c < 4; ++c)
+	{
+		const glm::vec2 corner = glm::vec2{ (c & 1) ? box_max.x : box_min.x, (c & 2) ? box_max.y : box_min.y } - eye;
+		d_max = std::max(d_max, glm::length(corner));
+		float a = std::atan2(corner.y, corner.x) - a_center;
+		if (a > pi)
+			a -= 2 * pi;
+		else if (a < -pi)
+			a += 2 * pi;
+		lo = std::min(lo, a);
+		hi = std::max(hi, a);
+	}
+	a0 = a_center + lo;
+	a1 = a_center + hi;
+	while (a0 < 0)
+	{
+		a0 += 2 * pi;
+		a1 += 2 * pi;
+	}
+	return true;
+}
+
+void HorizonBuffer::addOccluder(glm::vec2 const& box_min, glm::vec2 const& box_max, float ground)
+{
+	float a0, a1, d_min, d_max;
+	if (!extent(box_min, box_max, a0, a1, d_min, d_max))
+		return;
+	// Lowest slope of the top of the occluder along the rays crossing it
+	const float h = ground - _eye.y;
+	const float slope = h / (h >= 0 ? d_max : d_min);
+	// Bins entirely within [a0, a1], with a margin against the rounding
+	constexpr float bin_angle = 2 * std::numbers::pi_v<float> / Bins;
+	const int first = int(std::ceil(a0 / bin_angle + 1e-3f));
+	const int last = int(std::floor(a1 / bin_angle - 1e-3f)) - 1;
+	for (int b = first; b <= last; ++b)
+	{
+		float& s = _slopes[b % Bins];
+		s = std::max(s, slope);
+	}
+}
+
+bool HorizonBuffer::occluded(glm::vec2 const& box_min, glm::vec2 const& box_max, float top)const
+{
+	float a0, a1, d_min, d_max;
+	if (!extent(box_min, box_max, a0, a1, d_min, d_max))
+		return false;
+	// Highest slope of the box
+	const float h = top - _eye.y;
+	const float slope = h / (h >= 0 ? d_min : d_max);
+	// Bins touching [a0, a1], with a margin against the rounding
+	constexpr float bin_angle = 2 * std::numbers::pi_v<float> / Bins;
+	const int first = int(std::floor(a0 / bin_angle - 1e-3f));
+	const int last = int(std::floor(a1 / bin_angle + 1e-3f));
+	for (int b = first; b <= last; ++b)
+	{
+		if (!(slope < _slopes[(b + Bins) % Bins]))
+			return false;
+	}
+	return true;
+}
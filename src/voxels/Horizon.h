@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+
+// Heights of a chunk for the horizon culling: every column is opaque from the bottom of the world up to ground,
+// and no voxel is above top
+struct ChunkHeights
+{
+	int ground = 0;
+	int top = 0;
+
+	// From the occupancy columns, ground is lowered to the first section with a non opaque value in its palette
+	static ChunkHeights compute(Chunk const& chunk, OpaqueTable const& opaque);
+};
+
+// Horizon seen from the eye over a heightfield: per bin of azimuth, the highest slope (height over horizontal
+// distance, relative to the eye) under which everything is hidden by the occluders added so far.
+// The occluders must be added from the nearest to the furthest: a box is only hidden by the occluders added before
+// its test, that the rays from the eye cross before reaching it (World adds them by ring of chunks around the camera).
+// The eye must not be under the bottom of the world (y = 0).
+class HorizonBuffer
+{
+public:
+
+	static constexpr int Bins = 1024;
+
+protected:
+
+	glm::vec3 _eye;
+	std::vector<float> _slopes;
+
+	// Azimuths [a0, a1] (a1 - a0 < pi, a0 in [0, 2pi)) and horizontal distances [d_min, d_max] of the footprint seen
+	// from the eye, false if the eye is above the footprint
+	bool extent(glm::vec2 const& box_min, glm::vec2 const& box_max, float& a0, float& a1, float& d_min, float& d_max)const;
+
+public:
+
+	HorizonBuffer();
+
+	void reset(glm::vec3 const& eye);
+
+	// Adds the footprint [box_min, box_max] (x, z), opaque from the bottom of the world to ground.
+	// Only the bins that are entirely within its azimuths are raised.
+	void addOccluder(glm::vec2 const& box_min, glm::vec2 const& box_max, float ground);
+
+	// The footprint [box_min, box_max] (x, z) up to top is under the horizon in all the bins it touches
+	bool occluded(glm::vec2 const& box_min, glm::vec2 const& box_max, float top)const;
+};
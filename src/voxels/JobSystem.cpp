@@ -0,0 +1,81 @@
+#include <voxels/JobSystem.h>
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int n_workers):
+	_stop(false),
+	_running(0)
+{
+	if (n_workers == 0)
+	{
+		n_workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+	_workers.reserve(n_workers);
+	for (unsigned int i = 0; i < n_workers; ++i)
+	{
+		_workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::unique_lock lock(_mutex);
+		_stop = true;
+		_jobs.clear();
+	}
+	_cv.notify_all();
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::workerLoop()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock lock(_mutex);
+			_cv.wait(lock, [this]() {return _stop || !_jobs.empty(); });
+			if (_stop)
+				return;
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+			++_running;
+		}
+		job();
+		{
+			std::unique_lock lock(_mutex);
+			--_running;
+			if (_running == 0 && _jobs.empty())
+				_idle_cv.notify_all();
+		}
+	}
+}
+
+void JobSystem::submit(Job&& job)
+{
+	{
+		std::unique_lock lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_cv.notify_one();
+}
+
+unsigned int JobSystem::workerCount()const
+{
+	return _workers.size();
+}
+
+size_t JobSystem::pendingJobs()
+{
+	std::unique_lock lock(_mutex);
+	return _jobs.size() + _running;
+}
+
+void JobSystem::wait()
+{
+	std::unique_lock lock(_mutex);
+	_idle_cv.wait(lock, [this]() {return _jobs.empty() && _running == 0; });
+}
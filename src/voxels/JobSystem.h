@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// Fixed pool of worker threads consuming a FIFO of jobs.
+// Jobs must not touch the GL context, only the thread that owns it can do that.
+class JobSystem
+{
+public:
+
+	using Job = std::function<void()>;
+
+protected:
+
+	std::vector<std::thread> _workers;
+
+	std::deque<Job> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	// Notified when the last job finishes
+	std::condition_variable _idle_cv;
+	bool _stop;
+
+	std::atomic<size_t> _running;
+
+	void workerLoop();
+
+public:
+
+	// 0 -> hardware_concurrency - 1 (at least 1)
+	JobSystem(unsigned int n_workers = 0);
+
+	JobSystem(JobSystem const&) = delete;
+
+	// Pending jobs that did not start yet are discarded
+	~JobSystem();
+
+	void submit(Job&& job);
+
+	unsigned int workerCount()const;
+
+	// jobs waiting + jobs running
+	size_t pendingJobs();
+
+	// Blocks until all the submitted jobs are done
+	void wait();
+};
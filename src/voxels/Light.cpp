@@ -0,0 +1,422 @@
+#include <voxels/Light.h>
+#include <algorithm>
+#include <cassert>
+#include <bit>
+
+namespace
+{
+	// The palette of a section has non air values that are not opaque (the occupancy is not its opacity), or emissive values
+	void scanPalette(PaletteStorage const& section, OpaqueTable const& opaque, EmissionTable const& emission, bool& translucent, bool& emissive)
+	{
+		translucent = false;
+		emissive = false;
+		for (Voxel v : section.palette())
+		{
+			const bool in_table = uint32_t(v.id) < opaque.size();
+			translucent |= v.id != 0 && in_table && !opaque[v.id];
+			emissive |= in_table && emission[v.id] != 0;
+		}
+	}
+
+	bool isOpaque(OpaqueTable const& opaque, Voxel v)
+	{
+		return v.id != 0 && (uint32_t(v.id) >= opaque.size() || opaque[v.id]);
+	}
+
+	uint8_t emitted(EmissionTable const& emission, Voxel v)
+	{
+		return uint32_t(v.id) < emission.size() ? emission[v.id] : 0;
+	}
+}
+
+LightMargin::LightMargin(glm::ivec3 dims) :
+	_dims(dims),
+	_words((dims.y + Chunk::ColumnWordBits - 1) / Chunk::ColumnWordBits),
+	_opaque(size_t(dims.x + 2 * Margin) * (dims.z + 2 * Margin) * _words, 0)
+{}
+
+void LightMargin::setNeighbour(glm::ivec2 offset, Chunk const& neighbour, OpaqueTable const& opaque, EmissionTable const& emission)
+{
+	assert(neighbour.dims() == _dims);
+	assert(Margin <= _dims.x && Margin <= _dims.z);
+	// Columns of the margin covered by the neighbour, in the coordinates of the lit chunk
+	const auto range = [](int o, int size)
+	{
+		return o < 0 ? glm::ivec2{ -Margin, 0 } : (o == 0 ? glm::ivec2{ 0, size } : glm::ivec2{ size, size + Margin });
+	};
+	const glm::ivec2 rx = range(offset.x, _dims.x);
+	const glm::ivec2 rz = range(offset.y, _dims.z);
+	// From the lit chunk to the neighbour
+	const glm::ivec3 shift = { -offset.x * _dims.x, 0, -offset.y * _dims.z };
+
+	for (int x = rx[0]; x < rx[1]; ++x)
+	{
+		for (int z = rz[0]; z < rz[1]; ++z)
+		{
+			const uint64_t* src = neighbour.occupancyColumn(x + shift.x, z + shift.z);
+			std::copy_n(src, _words, _opaque.begin() + columnIndex(x, z));
+		}
+	}
+
+	for (int s = 0; s < neighbour.sectionCount(); ++s)
+	{
+		bool translucent, emissive;
+		scanPalette(neighbour.section(s), opaque, emission, translucent, emissive);
+		if (!translucent && !emissive)
+			continue;
+		const int y0 = s * Chunk::SectionHeight;
+		const int y1 = std::min(y0 + Chunk::SectionHeight, _dims.y);
+		for (int x = rx[0]; x < rx[1]; ++x)
+		{
+			for (int z = rz[0]; z < rz[1]; ++z)
+			{
+				uint64_t* col = _opaque.data() + columnIndex(x, z);
+				for (int y = y0; y < y1; ++y)
+				{
+					const Voxel v = neighbour(glm::ivec3{ x, y, z } + shift);
+					if (translucent && v.id != 0 && !isOpaque(opaque, v))
+						col[y / Chunk::ColumnWordBits] &= ~(uint64_t(1) << (y % Chunk::ColumnWordBits));
+					if (emissive && emitted(emission, v))
+						_sources.push_back({ { x, y, z }, emitted(emission, v) });
+				}
+			}
+		}
+	}
+}
+
+std::vector<LightMargin::Source> const& LightMargin::sources()const
+{
+	return _sources;
+}
+
+void LightMargin::setNeighbourLight(glm::ivec2 offset, std::shared_ptr<const ChunkLight> light)
+{
+	_lights[(offset.x + 1) * 3 + offset.y + 1] = std::move(light);
+}
+
+ChunkLight const* LightMargin::neighbourLight(int x, int z, glm::ivec2& local)const
+{
+	const glm::ivec2 offset = { x < 0 ? -1 : (x < _dims.x ? 0 : 1), z < 0 ? -1 : (z < _dims.z ? 0 : 1) };
+	local = { x - offset.x * _dims.x, z - offset.y * _dims.z };
+	return _lights[(offset.x + 1) * 3 + offset.y + 1].get();
+}
+
+LightBuilder::LightBuilder(std::vector<Property> const& properties) :
+	_opaque(makeOpaqueTable(properties)),
+	_emission(makeEmissionTable(properties))
+{}
+
+void LightBuilder::prepare(Chunk const& chunk, LightMargin const& margin, int min_height, LightVolume& res, std::vector<LightMargin::Source>& sources)const
+{
+	constexpr int M = LightMargin::Margin;
+	constexpr int MaxLight = LightMargin::MaxLight;
+	const glm::ivec3 dims = chunk.dims();
+	const int words = chunk.columnWords();
+	const int px = dims.x + 2 * M;
+	const int pz = dims.z + 2 * M;
+	const auto inside = [&](int x, int z) {return x >= 0 && x < dims.x && z >= 0 && z < dims.z; };
+
+	// Opacity of the chunk, the occupancy corrected in the sections with transparent values
+	thread_local std::vector<uint64_t> opacity;
+	opacity.assign(chunk.occupancyColumn(0, 0), chunk.occupancyColumn(0, 0) + size_t(dims.x) * dims.z * words);
+	sources = margin.sources();
+	for (int s = 0; s < chunk.sectionCount(); ++s)
+	{
+		bool translucent, emissive;
+		scanPalette(chunk.section(s), _opaque, _emission, translucent, emissive);
+		if (!translucent && !emissive)
+			continue;
+		const int y0 = s * Chunk::SectionHeight;
+		const int y1 = std::min(y0 + Chunk::SectionHeight, dims.y);
+		for (int x = 0; x < dims.x; ++x)
+		{
+			for (int z = 0; z < dims.z; ++z)
+			{
+				uint64_t* col = opacity.data() + (size_t(x) * dims.z + z) * words;
+				for (int y = y0; y < y1; ++y)
+				{
+					const Voxel v = chunk(glm::ivec3{ x, y, z });
+					if (translucent && v.id != 0 && !isOpaque(_opaque, v))
+						col[y / Chunk::ColumnWordBits] &= ~(uint64_t(1) << (y % Chunk::ColumnWordBits));
+					if (emissive && emitted(_emission, v))
+						sources.push_back({ { x, y, z }, emitted(_emission, v) });
+				}
+			}
+		}
+	}
+	const auto column = [&](int x, int z) -> const uint64_t*
+	{
+		return inside(x, z) ? opacity.data() + (size_t(x) * dims.z + z) * words : margin.column(x, z);
+	};
+
+	// The volume stops where the light can not change anymore: above the highest opaque cell, and
+	// above the range of the highest source (its light could go over a wall)
+	int height = min_height;
+	for (int x = -M; x < dims.x + M; ++x)
+	{
+		for (int z = -M; z < dims.z + M; ++z)
+		{
+			const uint64_t* col = column(x, z);
+			for (int w = words - 1; w >= 0; --w)
+			{
+				if (col[w])
+				{
+					height = std::max(height, (w + 1) * Chunk::ColumnWordBits - std::countl_zero(col[w]));
+					break;
+				}
+			}
+		}
+	}
+	for (LightMargin::Source const& source : sources)
+		height = std::max(height, source.position.y + MaxLight);
+	height = std::min(height, dims.y);
+
+	res._dims = dims;
+	res._pz = pz;
+	res._height = height;
+	const size_t cells = size_t(px) * pz * height;
+	res._light.assign(cells, 0);
+	res._opaque.resize(cells);
+	for (int x = -M; x < dims.x + M; ++x)
+	{
+		for (int z = -M; z < dims.z + M; ++z)
+		{
+			const uint64_t* col = column(x, z);
+			const size_t first = res.index(x, 0, z);
+			for (int y = 0; y < height; ++y)
+				res._opaque[first + y] = (col[y / Chunk::ColumnWordBits] >> (y % Chunk::ColumnWordBits)) & 1;
+		}
+	}
+}
+
+size_t LightBuilder::propagate(LightVolume& res, std::vector<uint32_t>& queue, int shift)
+{
+	constexpr int MaxLight = LightMargin::MaxLight;
+	const int height = res._height;
+	const int pz = res._pz;
+	const int px = res._dims.x + 2 * LightVolume::Margin;
+	// Strides of the cells in the volume
+	const size_t sy = 1, sz = height, sx = size_t(pz) * height;
+	// Cells are queued again when their light is raised, the queue is not popped to be reused
+	for (size_t i = 0; i < queue.size(); ++i)
+	{
+		const uint32_t c = queue[i];
+		const int l = (res._light[c] >> shift) & 15;
+		if (l <= 1)
+			continue;
+		const int y = int(c % height);
+		const int iz = int(c / height % pz);
+		const int ix = int(c / sx);
+		const auto spread = [&](size_t n, int level)
+		{
+			if (!res._opaque[n] && ((res._light[n] >> shift) & 15) < level)
+			{
+				res._light[n] = uint8_t((res._light[n] & ~(15 << shift)) | (level << shift));
+				queue.push_back(uint32_t(n));
+			}
+		};
+		// Straight down, the open sky stays at its maximum
+		if (y > 0)
+			spread(c - sy, (shift == 4 && l == MaxLight) ? l : l - 1);
+		if (y < height - 1)
+			spread(c + sy, l - 1);
+		if (iz > 0)
+			spread(c - sz, l - 1);
+		if (iz < pz - 1)
+			spread(c + sz, l - 1);
+		if (ix > 0)
+			spread(c - sx, l - 1);
+		if (ix < px - 1)
+			spread(c + sx, l - 1);
+	}
+	const size_t visited = queue.size();
+	queue.clear();
+	return visited;
+}
+
+size_t LightBuilder::build(Chunk const& chunk, LightMargin const& margin, LightVolume& res)const
+{
+	constexpr int M = LightMargin::Margin;
+	thread_local std::vector<LightMargin::Source> sources;
+	prepare(chunk, margin, 0, res, sources);
+	const glm::ivec3 dims = chunk.dims();
+	const int height = res._height;
+	const int pz = res._pz;
+	const int px = dims.x + 2 * M;
+	const size_t cells = res._light.size();
+
+	// Sky light straight down to the first opaque cell of the columns
+	for (int x = -M; x < dims.x + M; ++x)
+	{
+		for (int z = -M; z < dims.z + M; ++z)
+		{
+			const size_t first = res.index(x, 0, z);
+			for (int y = height - 1; y >= 0 && !res._opaque[first + y]; --y)
+				res._light[first + y] = LightVolume::SkyLight;
+		}
+	}
+
+	const size_t sz = height, sx = size_t(pz) * height;
+	thread_local std::vector<uint32_t> queue;
+	size_t visited = 0;
+
+	// Sky light: from the lit cells next to darker ones (under the overhangs, in the caves)
+	for (size_t c = 0; c < cells; ++c)
+	{
+		if (res._light[c] != LightVolume::SkyLight)
+			continue;
+		const int iz = int(c / height % pz);
+		const int ix = int(c / sx);
+		const auto darker = [&](size_t n) {return !res._opaque[n] && res._light[n] < LightVolume::SkyLight; };
+		if ((iz > 0 && darker(c - sz)) || (iz < pz - 1 && darker(c + sz)) || (ix > 0 && darker(c - sx)) || (ix < px - 1 && darker(c + sx)))
+			queue.push_back(uint32_t(c));
+	}
+	visited += propagate(res, queue, 4);
+
+	// Block light: from the sources
+	for (LightMargin::Source const& source : sources)
+	{
+		const size_t c = res.index(source.position.x, source.position.y, source.position.z);
+		if ((res._light[c] & 15) < source.level)
+		{
+			res._light[c] = uint8_t((res._light[c] & 0xf0) | source.level);
+			queue.push_back(uint32_t(c));
+		}
+	}
+	visited += propagate(res, queue, 0);
+
+	return visited;
+}
+
+size_t LightBuilder::update(Chunk const& chunk, LightMargin const& margin, ChunkLight const& previous, std::span<const glm::ivec3> edited, LightVolume& res)const
+{
+	constexpr int M = LightMargin::Margin;
+	constexpr int MaxLight = LightMargin::MaxLight;
+	thread_local std::vector<LightMargin::Source> sources;
+	// At least as high as before the edits, so that the cells lit then are in the volume
+	prepare(chunk, margin, previous.height(), res, sources);
+	const glm::ivec3 dims = chunk.dims();
+	const int height = res._height;
+	const int pz = res._pz;
+	const int px = dims.x + 2 * M;
+
+	// The light before the edits, from the chunk and its neighbours
+	for (int x = -M; x < dims.x + M; ++x)
+	{
+		for (int z = -M; z < dims.z + M; ++z)
+		{
+			glm::ivec2 local = { x, z };
+			ChunkLight const* light = (x >= 0 && x < dims.x && z >= 0 && z < dims.z) ? &previous : margin.neighbourLight(x, z, local);
+			assert(light);
+			const size_t first = res.index(x, 0, z);
+			const int below = std::min(height, light->height());
+			std::copy_n(light->column(local.x, local.y), below, res._light.begin() + first);
+			std::fill(res._light.begin() + first + below, res._light.begin() + first + height, LightVolume::SkyLight);
+		}
+	}
+
+	const size_t sy = 1, sz = height, sx = size_t(pz) * height;
+	const auto inVolume = [&](glm::ivec3 const& p)
+	{
+		return p.x >= -M && p.x < dims.x + M && p.z >= -M && p.z < dims.z + M && p.y >= 0 && p.y < height;
+	};
+	// Calls f(n, down) for the cells n around the cell c of the volume
+	const auto forNeighbours = [&](size_t c, auto const& f)
+	{
+		const int y = int(c % height);
+		const int iz = int(c / height % pz);
+		const int ix = int(c / sx);
+		if (y > 0)				f(c - sy, true);
+		if (y < height - 1)		f(c + sy, false);
+		if (iz > 0)				f(c - sz, false);
+		if (iz < pz - 1)		f(c + sz, false);
+		if (ix > 0)				f(c - sx, false);
+		if (ix < px - 1)		f(c + sx, false);
+	};
+
+	thread_local std::vector<std::pair<uint32_t, int>> removed;
+	thread_local std::vector<uint32_t> queue;
+	size_t visited = 0;
+	for (int shift : { 4, 0 })
+	{
+		const auto level = [&](size_t c) {return (res._light[c] >> shift) & 15; };
+		const auto clear = [&](size_t c) {res._light[c] &= uint8_t(~(15 << shift)); };
+
+		// Removal: from the edited cells, the cells whose light came from them (darker, or the open sky below),
+		// the brighter ones around them are lit by something else and spread again
+		removed.clear();
+		for (glm::ivec3 const& p : edited)
+		{
+			if (!inVolume(p))
+				continue;
+			const size_t c = res.index(p.x, p.y, p.z);
+			if (level(c))
+			{
+				removed.push_back({ uint32_t(c), level(c) });
+				clear(c);
+			}
+		}
+		for (size_t i = 0; i < removed.size(); ++i)
+		{
+			const auto [c, l] = removed[i];
+			forNeighbours(c, [&](size_t n, bool down)
+				{
+					const int ln = level(n);
+					if (ln == 0)
+						return;
+					if (ln < l || (shift == 4 && down && l == MaxLight))
+					{
+						removed.push_back({ uint32_t(n), ln });
+						clear(n);
+					}
+					else
+					{
+						queue.push_back(uint32_t(n));
+					}
+				}
+			);
+		}
+		visited += removed.size();
+
+		// The edited cells are lit again by the cells around them
+		for (glm::ivec3 const& p : edited)
+		{
+			if (!inVolume(p))
+				continue;
+			const size_t c = res.index(p.x, p.y, p.z);
+			forNeighbours(c, [&](size_t n, bool) {queue.push_back(uint32_t(n)); });
+			// Under the open sky, above the volume
+			if (shift == 4 && p.y == height - 1 && !res._opaque[c])
+			{
+				res._light[c] |= LightVolume::SkyLight;
+				queue.push_back(uint32_t(c));
+			}
+		}
+		// and the sources, the removal could have reached them
+		if (shift == 0)
+		{
+			for (LightMargin::Source const& source : sources)
+			{
+				const size_t c = res.index(source.position.x, source.position.y, source.position.z);
+				if (level(c) < source.level)
+				{
+					res._light[c] = uint8_t((res._light[c] & 0xf0) | source.level);
+					queue.push_back(uint32_t(c));
+				}
+			}
+		}
+		visited += propagate(res, queue, shift);
+	}
+
+	return visited;
+}
+
+void LightVolume::copyChunk(ChunkLight& res)const
+{
+	res._dims = _dims;
+	res._height = _height;
+	res._light.resize(size_t(_dims.x) * _dims.z * _height);
+	for (int x = 0; x < _dims.x; ++x)
+		for (int z = 0; z < _dims.z; ++z)
+			std::copy_n(_light.begin() + index(x, 0, z), _height, res._light.begin() + (size_t(x) * _dims.z + z) * _height);
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+
+// Sky light (from the top of the world, not decreasing downwards in the open) and block light (from the emissive
+// blocks, see Property::EmissionShift), in [0, MaxLight], decreasing by one per cell through the cells that are not opaque.
+// The light of a cell only depends on the cells within MaxLight columns of it: the light of a chunk is computed
+// by its meshing job from its voxels and a margin of the columns of its neighbours.
+// The light of the cells of a chunk is kept (ChunkLight): after edits it is updated incrementally from the edited cells.
+
+class ChunkLight;
+
+// The neighbourhood of a chunk for its light: the opacity of the columns of the 8 chunks around it within Margin
+// columns, and their light sources there. Copied on the main thread, the workers can not read the other chunks
+// (which can be edited or unloaded meanwhile). Missing neighbours are transparent, as in ChunkApron.
+class LightMargin
+{
+public:
+
+	static constexpr int MaxLight = 15;
+
+	// The cells up to one cell away from the chunk get their exact light (the faces against the borders read them)
+	static constexpr int Margin = MaxLight;
+
+	struct Source
+	{
+		// In the coordinates of the lit chunk
+		glm::ivec3 position;
+		int level;
+	};
+
+protected:
+
+	glm::ivec3 _dims;
+	int _words;
+	// Same layout as the occupancy of a chunk: bit y % 64 of column(x, z)[y / 64] (the columns of the chunk are unused)
+	std::vector<uint64_t> _opaque;
+	std::vector<Source> _sources;
+	// Light of the neighbours before the edits, [(offset.x + 1) * 3 + offset.y + 1], for LightBuilder::update
+	std::shared_ptr<const ChunkLight> _lights[9];
+
+	size_t columnIndex(int x, int z)const
+	{
+		return (size_t(x + Margin) * (_dims.z + 2 * Margin) + (z + Margin)) * _words;
+	}
+
+public:
+
+	LightMargin(glm::ivec3 dims = { 0, 0, 0 });
+
+	// x and z in [-Margin, dims + Margin)
+	uint64_t const* column(int x, int z)const
+	{
+		return _opaque.data() + columnIndex(x, z);
+	}
+
+	// The chunk at offset (in [-1, 1]^2, not (0, 0)) of the lit one, nothing to do for a missing one
+	void setNeighbour(glm::ivec2 offset, Chunk const& neighbour, OpaqueTable const& opaque, EmissionTable const& emission);
+
+	std::vector<Source> const& sources()const;
+
+	// The light of the chunk at offset (in [-1, 1]^2, not (0, 0)), built before the edits to light
+	void setNeighbourLight(glm::ivec2 offset, std::shared_ptr<const ChunkLight> light);
+
+	// Light of the neighbour covering the column (x, z) of the margin (nullptr if not set), local: the column in it
+	ChunkLight const* neighbourLight(int x, int z, glm::ivec2& local)const;
+};
+
+// Light and opacity of the cells of a chunk and of its margin, written by LightBuilder (reused between the builds).
+// Coordinates of the chunk: x and z in [-Margin, dims + Margin), any y (open sky above the volume, opaque under it).
+class LightVolume
+{
+protected:
+
+	friend class LightBuilder;
+
+	static constexpr int Margin = LightMargin::Margin;
+
+	glm::ivec3 _dims = { 0, 0, 0 };
+	int _pz = 0;
+	// The cells at and above height are in the open sky
+	int _height = 0;
+	// sky << 4 | block, [index(x, y, z)], the columns are contiguous
+	std::vector<uint8_t> _light;
+	std::vector<uint8_t> _opaque;
+
+	size_t index(int x, int y, int z)const
+	{
+		return (size_t(x + Margin) * _pz + (z + Margin)) * _height + y;
+	}
+
+public:
+
+	static constexpr uint8_t SkyLight = LightMargin::MaxLight << 4;
+
+	static int sky(uint8_t light)
+	{
+		return light >> 4;
+	}
+
+	static int block(uint8_t light)
+	{
+		return light & 15;
+	}
+
+	uint8_t light(int x, int y, int z)const
+	{
+		if (y >= _height)
+			return SkyLight;
+		if (y < 0)
+			return 0;
+		return _light[index(x, y, z)];
+	}
+
+	bool opaque(int x, int y, int z)const
+	{
+		if (y >= _height)
+			return false;
+		if (y < 0)
+			return true;
+		return _opaque[index(x, y, z)];
+	}
+
+	int height()const
+	{
+		return _height;
+	}
+
+	// The light of the cells of the chunk, without the margin
+	void copyChunk(ChunkLight& res)const;
+};
+
+// Light of the cells of a chunk, without its margin, copied from its LightVolume. Not modified once built: shared
+// between the main thread which keeps it and the workers which light the edits of the chunk and of its neighbours from it.
+class ChunkLight
+{
+protected:
+
+	friend class LightVolume;
+
+	glm::ivec3 _dims = { 0, 0, 0 };
+	// Of the volume it was copied from, the cells at and above are in the open sky
+	int _height = 0;
+	// [(x * dims.z + z) * height + y], the columns are contiguous
+	std::vector<uint8_t> _light;
+
+public:
+
+	// height values, x and z in [0, dims)
+	uint8_t const* column(int x, int z)const
+	{
+		return _light.data() + (size_t(x) * _dims.z + z) * _height;
+	}
+
+	uint8_t light(int x, int y, int z)const
+	{
+		if (y >= _height)
+			return LightVolume::SkyLight;
+		if (y < 0)
+			return 0;
+		return column(x, z)[y];
+	}
+
+	int height()const
+	{
+		return _height;
+	}
+
+	size_t byteSize()const
+	{
+		return _light.size();
+	}
+};
+
+// Breadth first propagation of the sky and block light through a chunk and its margin.
+// The volume stops above the highest opaque cell (the highest source + MaxLight with sources), the sky being open there.
+// The sky light goes straight down at MaxLight through the open cells, and decreases by one in the other directions.
+// Thread safe: build() and update() can be called from several workers at the same time.
+class LightBuilder
+{
+protected:
+
+	OpaqueTable _opaque;
+	EmissionTable _emission;
+
+	// Sizes the volume (at least min_height high) and sets the opacity of its cells, their light to 0.
+	// sources: the light sources of the chunk and of the margin
+	void prepare(Chunk const& chunk, LightMargin const& margin, int min_height, LightVolume& res, std::vector<LightMargin::Source>& sources)const;
+
+	// Spreads the light of the channel (shift 4: sky, 0: block) from the queued cells, returns the number of cells visited
+	static size_t propagate(LightVolume& res, std::vector<uint32_t>& queue, int shift);
+
+public:
+
+	LightBuilder(std::vector<Property> const& properties = {});
+
+	// Returns the number of cells visited by the propagation
+	size_t build(Chunk const& chunk, LightMargin const& margin, LightVolume& res)const;
+
+	// The light after the edits of the cells edited (in the coordinates of the chunk, the ones out of the volume are skipped),
+	// from previous, the light of the chunk before them, and the ones of the 8 neighbours set in the margin.
+	// The light of the edited cells is removed breadth first as far as it reached, then the light of the cells around the
+	// removed ones, of the edited ones and of the sources spreads again: only the cells the edits can change are visited.
+	// Returns the number of cells visited by the removal and the propagation
+	size_t update(Chunk const& chunk, LightMargin const& margin, ChunkLight const& previous, std::span<const glm::ivec3> edited, LightVolume& res)const;
+};
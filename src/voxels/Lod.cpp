@@ -0,0 +1,83 @@
+#include <voxels/Lod.h>
+#include <cassert>
+#include <algorithm>
+
+LodBuilder::LodBuilder(std::vector<Property> const& properties):
+	_face_builder(properties)
+{}
+
+glm::ivec3 LodBuilder::levelDims(glm::ivec3 const& dims, int level)
+{
+	return { dims.x >> level, dims.y >> level, dims.z >> level };
+}
+
+void LodBuilder::downsample(glm::ivec3 const& src_dims, const int32_t* src, int32_t* dst)
+{
+	const glm::ivec3 dims = src_dims / 2;
+	const auto srcId = [&](int x, int y, int z)
+	{
+		return src[(size_t(x) * src_dims.y + y) * src_dims.z + z];
+	};
+	for (int x = 0; x < dims.x; ++x)
+	{
+		for (int y = 0; y < dims.y; ++y)
+		{
+			for (int z = 0; z < dims.z; ++z)
+			{
+				int32_t children[8];
+				int n = 0;
+				for (int i = 0; i < 8; ++i)
+				{
+					const int32_t id = srcId(2 * x + (i >> 2), 2 * y + ((i >> 1) & 1), 2 * z + (i & 1));
+					if (id != 0)
+						children[n++] = id;
+				}
+				int32_t res = 0;
+				if (n >= 4)
+				{
+					int best_count = 0;
+					for (int i = 0; i < n; ++i)
+					{
+						const int count = int(std::count(children, children + n, children[i]));
+						if (count > best_count)
+						{
+							best_count = count;
+							res = children[i];
+						}
+					}
+				}
+				dst[(size_t(x) * dims.y + y) * dims.z + z] = res;
+			}
+		}
+	}
+}
+
+void LodBuilder::build(Chunk const& chunk, LodFaces& res)const
+{
+	const glm::ivec3 dims = chunk.dims();
+	thread_local std::vector<int32_t> ids[2];
+	thread_local std::vector<Voxel> values;
+	ids[0].resize(chunk.size());
+	chunk.decode(ids[0].data());
+
+	for (int level = 1; level <= Levels; ++level)
+	{
+		const glm::ivec3 src_dims = levelDims(dims, level - 1);
+		const glm::ivec3 level_dims = levelDims(dims, level);
+		assert(level_dims.x > 0 && level_dims.y % Chunk::SectionHeight == 0 && level_dims.z > 0);
+		std::vector<int32_t>& src = ids[(level - 1) % 2];
+		std::vector<int32_t>& dst = ids[level % 2];
+		dst.resize(size_t(level_dims.x) * level_dims.y * level_dims.z);
+		downsample(src_dims, src.data(), dst.data());
+
+		// Back in a chunk (array ids are section major) for the face builder
+		Chunk mip(level_dims);
+		values.resize(mip.size());
+		for (int x = 0; x < level_dims.x; ++x)
+			for (int y = 0; y < level_dims.y; ++y)
+				for (int z = 0; z < level_dims.z; ++z)
+					values[mip.arrayId({ x, y, z })] = Voxel{ dst[(size_t(x) * level_dims.y + y) * level_dims.z + z] };
+		mip.assign(values.data());
+		_face_builder.build(mip, res[level - 1]);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+#include <voxels/FaceStream.h>
+
+// Downsampled versions of a chunk for the far terrain: level l has voxels of 2^l x 2^l x 2^l.
+// Each level is built from the previous one by majority vote of the 8 children: a voxel is non empty if
+// at least half of its children are, with the most frequent non empty id among them.
+// Only the faces of the levels are kept, drawn with a voxel size of 2^l.
+// Thread safe: build() can be called from several workers at the same time.
+class LodBuilder
+{
+public:
+
+	// Levels 1 to Levels (2x, 4x, 8x)
+	static constexpr int Levels = 3;
+
+	using LodFaces = std::array<ChunkFaces, Levels>;
+
+protected:
+
+	FaceBuilder _face_builder;
+
+public:
+
+	LodBuilder(std::vector<Property> const& properties = {});
+
+	static glm::ivec3 levelDims(glm::ivec3 const& dims, int level);
+
+	// src: ids of the level l - 1 in the linear layout (see Chunk::decode), dst: ids of the level l
+	static void downsample(glm::ivec3 const& src_dims, const int32_t* src, int32_t* dst);
+
+	void build(Chunk const& chunk, LodFaces& res)const;
+};
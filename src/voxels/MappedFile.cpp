@@ -0,0 +1,127 @@
+#include <voxels/MappedFile.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile():
+	_data(nullptr),
+	_size(0),
+	_file(INVALID_HANDLE_VALUE),
+	_mapping(nullptr)
+{}
+
+bool MappedFile::open(std::filesystem::path const& path)
+{
+	close();
+	_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping)
+	{
+		close();
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		close();
+		return false;
+	}
+	_size = size_t(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+	_data = nullptr;
+	_size = 0;
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile():
+	_data(nullptr),
+	_size(0),
+	_fd(-1)
+{}
+
+bool MappedFile::open(std::filesystem::path const& path)
+{
+	close();
+	_fd = ::open(path.c_str(), O_RDONLY);
+	if (_fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(_fd, &st) != 0 || st.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, _fd, 0);
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(data);
+	_size = size_t(st.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (_data)
+		munmap(const_cast<uint8_t*>(_data), _size);
+	if (_fd >= 0)
+		::close(_fd);
+	_data = nullptr;
+	_size = 0;
+	_fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::isOpen()const
+{
+	return _data != nullptr;
+}
+
+const uint8_t* MappedFile::data()const
+{
+	return _data;
+}
+
+size_t MappedFile::size()const
+{
+	return _size;
+}
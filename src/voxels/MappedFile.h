@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <cstdint>
+
+// Read only memory mapping of a whole file (MapViewOfFile on Windows, mmap elsewhere)
+class MappedFile
+{
+protected:
+
+	const uint8_t* _data;
+	size_t _size;
+
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#else
+	int _fd;
+#endif
+
+public:
+
+	MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+
+	~MappedFile();
+
+	// Returns false if the file can not be opened or is empty
+	bool open(std::filesystem::path const& path);
+
+	void close();
+
+	bool isOpen()const;
+
+	const uint8_t* data()const;
+
+	size_t size()const;
+};
@@ -0,0 +1,219 @@
+#include <voxels/Mesher.h>
+#include <cassert>
+#include <algorithm>
+
+ChunkMesh::ChunkMesh():
+	_handle(0),
+	_buffer_size(0),
+	_pool(nullptr)
+{}
+
+ChunkMesh::ChunkMesh(ChunkMesh&& other) :
+	_quads(std::move(other._quads)),
+	_handle(other._handle),
+	_buffer_size(other._buffer_size),
+	_pool(other._pool)
+{
+	other._handle = 0;
+	other._buffer_size = 0;
+}
+
+ChunkMesh::~ChunkMesh()
+{
+	deleteBuffer();
+}
+
+ChunkMesh& ChunkMesh::operator=(ChunkMesh&& other)
+{
+	deleteBuffer();
+	_quads = std::move(other._quads);
+	_handle = other._handle;
+	_buffer_size = other._buffer_size;
+	_pool = other._pool;
+	other._handle = 0;
+	other._buffer_size = 0;
+	return *this;
+}
+
+void ChunkMesh::clear()
+{
+	_quads.clear();
+}
+
+void ChunkMesh::addQuad(glm::ivec3 const& pos, int face, int w, int h, int32_t id)
+{
+	assert(pos.x < 64 && pos.y < 512 && pos.z < 64);
+	assert(w <= 511 && h <= 511 && id < 256);
+	_quads.push_back(uint32_t(pos.x) | (uint32_t(pos.y) << 6) | (uint32_t(pos.z) << 15) | (uint32_t(face) << 21));
+	_quads.push_back(uint32_t(w) | (uint32_t(h) << 9) | (uint32_t(id) << 18));
+}
+
+size_t ChunkMesh::quadCount()const
+{
+	return _quads.size() / WordsPerQuad;
+}
+
+size_t ChunkMesh::triangleCount()const
+{
+	return quadCount() * 2;
+}
+
+size_t ChunkMesh::byteSize()const
+{
+	return _quads.size() * sizeof(uint32_t);
+}
+
+size_t ChunkMesh::deviceMemoryUsage()const
+{
+	return _buffer_size;
+}
+
+void ChunkMesh::upload(BufferPool* pool)
+{
+	if (_handle && (byteSize() > _buffer_size || pool != _pool))
+		deleteBuffer();
+	if (_handle == 0)
+	{
+		_pool = pool;
+		if (_pool)
+		{
+			_handle = _pool->acquire(byteSize(), _buffer_size);
+		}
+		else
+		{
+			glCreateBuffers(1, &_handle);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+			_buffer_size = std::max(byteSize(), sizeof(uint32_t));
+			glBufferData(GL_SHADER_STORAGE_BUFFER, _buffer_size, _quads.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			return;
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _handle);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, byteSize(), _quads.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ChunkMesh::deleteBuffer()
+{
+	if (_handle)
+	{
+		if (_pool)
+			_pool->release(_handle, _buffer_size);
+		else
+			glDeleteBuffers(1, &_handle);
+	}
+	_handle = 0;
+	_buffer_size = 0;
+	_pool = nullptr;
+}
+
+void ChunkMesh::bind(int offset)const
+{
+	assert(_handle != 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, offset, _handle);
+}
+
+void ChunkMesh::draw()const
+{
+	// 2 triangles per quad, the vertices are pulled from the SSBO
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(quadCount() * 6));
+}
+
+
+
+GreedyMesher::GreedyMesher(std::vector<Property> const& properties):
+	_opaque(makeOpaqueTable(properties))
+{}
+
+void GreedyMesher::mesh(Chunk const& chunk, ChunkMesh& res, ChunkApron const* apron)const
+{
+	res.clear();
+	const glm::ivec3 dims = chunk.dims();
+	// Linear layout, z fastest (not the section major layout of the chunk)
+	const glm::ivec3 strides = { dims.y * dims.z, dims.z, 1 };
+
+	// Decode the palettes once, the neighbour lookups are then plain loads
+	thread_local std::vector<int32_t> ids;
+	thread_local std::vector<int32_t> mask;
+	ids.resize(chunk.size());
+	chunk.decode(ids.data());
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const int u_axis = (axis + 1) % 3;
+		const int v_axis = (axis + 2) % 3;
+		const int du = dims[u_axis], dv = dims[v_axis];
+		mask.resize(size_t(du) * dv);
+		for (int s = 0; s < 2; ++s)
+		{
+			const int front = s == 0 ? 1 : -1;
+			const int face = axis * 2 + s;
+			for (int slice = 0; slice < dims[axis]; ++slice)
+			{
+				const int front_slice = slice + front;
+				const bool front_in_grid = front_slice >= 0 && front_slice < dims[axis];
+				const int apron_side = (apron && !front_in_grid) ? ChunkApron::side(axis, s) : -1;
+
+				// Visible faces of the slice
+				glm::ivec3 p;
+				p[axis] = slice;
+				for (int k = 0; k < dv; ++k)
+				{
+					p[v_axis] = k;
+					for (int j = 0; j < du; ++j)
+					{
+						p[u_axis] = j;
+						const size_t aid = size_t(glm::dot(p, strides));
+						int32_t id = ids[aid];
+						if (id != 0 && front_in_grid)
+						{
+							const int32_t front_id = ids[aid + front * strides[axis]];
+							if (uint32_t(front_id) >= _opaque.size() || _opaque[front_id])
+								id = 0;
+						}
+						else if (id != 0 && apron_side >= 0 && apron->opaque(apron_side, p.y, axis == 0 ? p.z : p.x))
+						{
+							id = 0;
+						}
+						mask[j + size_t(k) * du] = id;
+					}
+				}
+
+				// Greedy merge the faces of the same type in rectangles
+				for (int k = 0; k < dv; ++k)
+				{
+					for (int j = 0; j < du;)
+					{
+						const int32_t id = mask[j + size_t(k) * du];
+						if (id == 0)
+						{
+							++j;
+							continue;
+						}
+						int w = 1;
+						while (j + w < du && mask[j + w + size_t(k) * du] == id)
+							++w;
+						int h = 1;
+						while (k + h < dv)
+						{
+							const int32_t* row = mask.data() + size_t(k + h) * du + j;
+							if (!std::all_of(row, row + w, [id](int32_t m) {return m == id; }))
+								break;
+							++h;
+						}
+						for (int kk = k; kk < k + h; ++kk)
+							std::fill_n(mask.data() + size_t(kk) * du + j, w, 0);
+
+						glm::ivec3 pos;
+						pos[axis] = slice;
+						pos[u_axis] = j;
+						pos[v_axis] = k;
+						res.addQuad(pos, face, w, h, id);
+						j += w;
+					}
+				}
+			}
+		}
+	}
+}
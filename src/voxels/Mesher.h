@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+#include <voxels/ChunkApron.h>
+
+// Quads of a chunk, drawn by vertex pulling (see voxel_mesh.vert)
+// Each quad is packed in 2 words:
+// [0]: x (6 bits) | y (9 bits) | z (6 bits) | face (3 bits)
+// [1]: w (9 bits) | h (9 bits) | block id (8 bits)
+// face = axis * 2 + s (s: 0 -> +, 1 -> -), w and h are the extents along the (axis+1)%3 and (axis+2)%3 axes
+class ChunkMesh
+{
+public:
+
+	static constexpr size_t WordsPerQuad = 2;
+
+protected:
+
+	std::vector<uint32_t> _quads;
+	GLuint _handle;
+	size_t _buffer_size;
+	// Where the buffer comes from, nullptr -> owned
+	BufferPool* _pool;
+
+public:
+
+	ChunkMesh();
+
+	ChunkMesh(ChunkMesh const&) = delete;
+
+	ChunkMesh(ChunkMesh&& other);
+
+	~ChunkMesh();
+
+	ChunkMesh& operator=(ChunkMesh&& other);
+
+	void clear();
+
+	void addQuad(glm::ivec3 const& pos, int face, int w, int h, int32_t id);
+
+	size_t quadCount()const;
+
+	size_t triangleCount()const;
+
+	size_t byteSize()const;
+
+	size_t deviceMemoryUsage()const;
+
+	// GL thread only, the buffer is taken from (and given back to) pool if not nullptr
+	void upload(BufferPool* pool = nullptr);
+
+	void deleteBuffer();
+
+	void bind(int offset = 1)const;
+
+	void draw()const;
+};
+
+// Builds the visible faces of a chunk, merging the coplanar faces of the same block type into rectangles.
+// Faces against the chunk borders are culled with the apron of the neighbours if given, always emitted otherwise.
+// Thread safe: mesh() can be called from several workers at the same time.
+class GreedyMesher
+{
+protected:
+
+	OpaqueTable _opaque;
+
+public:
+
+	GreedyMesher(std::vector<Property> const& properties = {});
+
+	void mesh(Chunk const& chunk, ChunkMesh& res, ChunkApron const* apron = nullptr)const;
+};
@@ -0,0 +1,175 @@
+#include <voxels/Noise.h>
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NOISE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SSE2 1
+#endif
+
+GradientNoise::GradientNoise(uint32_t seed)
+{
+	for (int i = 0; i < TableSize; ++i)
+		_perm[i] = i;
+	// xorshift32 driven Fisher-Yates shuffle
+	uint32_t state = seed * 2654435761u + 0x9e3779b9u;
+	if (state == 0)
+		state = 1;
+	for (int i = TableSize - 1; i > 0; --i)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		std::swap(_perm[i], _perm[state % uint32_t(i + 1)]);
+	}
+	for (int i = 0; i < 2 * TableSize; ++i)
+	{
+		const float angle = float(2.0 * std::numbers::pi) * float(_perm[i % TableSize]) / float(TableSize);
+		_grad_x[i] = std::cos(angle);
+		_grad_y[i] = std::sin(angle);
+	}
+}
+
+float GradientNoise::sample(float x, float y)const
+{
+	const float fx = std::floor(x), fy = std::floor(y);
+	const int ix = int(fx), iy = int(fy);
+	const float dx = x - fx, dy = y - fy;
+	const int p0 = _perm[ix & (TableSize - 1)];
+	const int p1 = _perm[(ix + 1) & (TableSize - 1)];
+
+	const float n00 = corner(p0, iy, dx, dy);
+	const float n10 = corner(p1, iy, dx - 1.0f, dy);
+	const float n01 = corner(p0, iy + 1, dx, dy - 1.0f);
+	const float n11 = corner(p1, iy + 1, dx - 1.0f, dy - 1.0f);
+
+	const float wx = fade(dx), wy = fade(dy);
+	const float a = n00 + (n10 - n00) * wx;
+	const float b = n01 + (n11 - n01) * wx;
+	return a + (b - a) * wy;
+}
+
+void GradientNoise::sampleGridScalar(float x0, float y0, float step, int nx, int ny, float* res)const
+{
+	for (int i = 0; i < nx; ++i)
+	{
+		const float x = x0 + float(i) * step;
+		for (int j = 0; j < ny; ++j)
+			res[i * ny + j] = sample(x, y0 + float(j) * step);
+	}
+}
+
+void GradientNoise::sampleGrid(float x0, float y0, float step, int nx, int ny, float* res)const
+{
+#if NOISE_AVX2 || NOISE_SSE2
+#if NOISE_AVX2
+	constexpr int Lanes = 8;
+	using Float = __m256;
+	using Int = __m256i;
+	const auto set1 = [](float f) { return _mm256_set1_ps(f); };
+	const auto set1i = [](int i) { return _mm256_set1_epi32(i); };
+	const auto add = [](Float a, Float b) { return _mm256_add_ps(a, b); };
+	const auto sub = [](Float a, Float b) { return _mm256_sub_ps(a, b); };
+	const auto mul = [](Float a, Float b) { return _mm256_mul_ps(a, b); };
+	const auto addi = [](Int a, Int b) { return _mm256_add_epi32(a, b); };
+	const auto andi = [](Int a, Int b) { return _mm256_and_si256(a, b); };
+	const auto floorv = [](Float a) { return _mm256_floor_ps(a); };
+	const auto toInt = [](Float a) { return _mm256_cvttps_epi32(a); };
+	const auto gather = [](const float* table, Int index) { return _mm256_i32gather_ps(table, index, 4); };
+	const auto store = [](float* dst, Float a) { _mm256_storeu_ps(dst, a); };
+	const Float lane_offsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+#else
+	constexpr int Lanes = 4;
+	using Float = __m128;
+	using Int = __m128i;
+	const auto set1 = [](float f) { return _mm_set1_ps(f); };
+	const auto set1i = [](int i) { return _mm_set1_epi32(i); };
+	const auto add = [](Float a, Float b) { return _mm_add_ps(a, b); };
+	const auto sub = [](Float a, Float b) { return _mm_sub_ps(a, b); };
+	const auto mul = [](Float a, Float b) { return _mm_mul_ps(a, b); };
+	const auto addi = [](Int a, Int b) { return _mm_add_epi32(a, b); };
+	const auto andi = [](Int a, Int b) { return _mm_and_si128(a, b); };
+	const auto floorv = [](Float a)
+	{
+		// SSE2 has no floor: truncate, then subtract 1 where that rounded up (negative values)
+		const Float t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+		return _mm_sub_ps(t, _mm_and_ps(_mm_cmplt_ps(a, t), _mm_set1_ps(1.0f)));
+	};
+	const auto toInt = [](Float a) { return _mm_cvttps_epi32(a); };
+	const auto gather = [](const float* table, Int index)
+	{
+		alignas(16) int32_t idx[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(idx), index);
+		return _mm_setr_ps(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+	};
+	const auto store = [](float* dst, Float a) { _mm_storeu_ps(dst, a); };
+	const Float lane_offsets = _mm_setr_ps(0, 1, 2, 3);
+#endif
+	const Float one = set1(1.0f);
+	const Float six = set1(6.0f), fifteen = set1(15.0f), ten = set1(10.0f);
+	const Int mask = set1i(TableSize - 1);
+	const Int int_one = set1i(1);
+	const auto fadev = [&](Float w)
+	{
+		return mul(mul(mul(w, w), w), add(mul(w, sub(mul(w, six), fifteen)), ten));
+	};
+	const auto cornerv = [&](Int h, Float dx, Float dy)
+	{
+		return add(mul(gather(_grad_x, h), dx), mul(gather(_grad_y, h), dy));
+	};
+
+	const int simd_ny = ny - ny % Lanes;
+	for (int i = 0; i < nx; ++i)
+	{
+		// Constant along the lanes
+		const float x = x0 + float(i) * step;
+		const float fx = std::floor(x);
+		const int ix = int(fx);
+		const float sdx = x - fx;
+		const Float dx0 = set1(sdx);
+		const Float dx1 = set1(sdx - 1.0f);
+		const Float wx = set1(fade(sdx));
+		const Int p0 = set1i(_perm[ix & (TableSize - 1)]);
+		const Int p1 = set1i(_perm[(ix + 1) & (TableSize - 1)]);
+
+		for (int j = 0; j < simd_ny; j += Lanes)
+		{
+			const Float y = add(set1(y0), mul(add(set1(float(j)), lane_offsets), set1(step)));
+			const Float fy = floorv(y);
+			const Int iy0 = andi(toInt(fy), mask);
+			const Int iy1 = andi(addi(toInt(fy), int_one), mask);
+			const Float dy0 = sub(y, fy);
+			const Float dy1 = sub(dy0, one);
+
+			const Float n00 = cornerv(addi(p0, iy0), dx0, dy0);
+			const Float n10 = cornerv(addi(p1, iy0), dx1, dy0);
+			const Float n01 = cornerv(addi(p0, iy1), dx0, dy1);
+			const Float n11 = cornerv(addi(p1, iy1), dx1, dy1);
+
+			const Float wy = fadev(dy0);
+			const Float a = add(n00, mul(sub(n10, n00), wx));
+			const Float b = add(n01, mul(sub(n11, n01), wx));
+			store(res + i * ny + j, add(a, mul(sub(b, a), wy)));
+		}
+		for (int j = simd_ny; j < ny; ++j)
+			res[i * ny + j] = sample(x, y0 + float(j) * step);
+	}
+#else
+	sampleGridScalar(x0, y0, step, nx, ny, res);
+#endif
+}
+
+const char* GradientNoise::instructionSet()
+{
+#if NOISE_AVX2
+	return "AVX2";
+#elif NOISE_SSE2
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
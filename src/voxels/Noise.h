@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// 2D Perlin (gradient) noise with the gradients looked up in hashed tables (no trigonometry per sample).
+// sampleGrid evaluates a whole grid at once, vectorized along y with AVX2 (8 lanes with gathers) or SSE2 (4 lanes),
+// sampleGridScalar is the fallback, they give the same results up to the rounding.
+class GradientNoise
+{
+public:
+
+	static constexpr int TableSize = 256;
+
+protected:
+
+	int32_t _perm[TableSize];
+	// [p + (iy & 255)] -> gradient of the corner hashed with p = _perm[ix & 255]
+	float _grad_x[2 * TableSize];
+	float _grad_y[2 * TableSize];
+
+	static float fade(float w)
+	{
+		return w * w * w * (w * (w * 6.0f - 15.0f) + 10.0f);
+	}
+
+	float corner(int p, int iy, float dx, float dy)const
+	{
+		const int h = p + (iy & (TableSize - 1));
+		return _grad_x[h] * dx + _grad_y[h] * dy;
+	}
+
+public:
+
+	GradientNoise(uint32_t seed = 0);
+
+	// In [-sqrt(2)/2, sqrt(2)/2]
+	float sample(float x, float y)const;
+
+	// res[i * ny + j] = sample(x0 + i * step, y0 + j * step)
+	void sampleGrid(float x0, float y0, float step, int nx, int ny, float* res)const;
+
+	void sampleGridScalar(float x0, float y0, float step, int nx, int ny, float* res)const;
+
+	// "AVX2", "SSE2" or "scalar"
+	static const char* instructionSet();
+};
@@ -0,0 +1,224 @@
+#include <voxels/PaletteStorage.h>
+#include <algorithm>
+
+PaletteStorage::PaletteStorage(size_t size, bool direct) :
+	_size(size),
+	_compressed(!direct),
+	_bits(direct ? DirectBits : 0),
+	_palette(direct ? 0 : 1, Voxel{ 0 }),
+	_words(wordCount(size, _bits), 0)
+{}
+
+uint32_t PaletteStorage::bitsFor(size_t palette_size)
+{
+	uint32_t res = 0;
+	while ((size_t(1) << res) < palette_size)
+		res = res == 0 ? 1 : res * 2;
+	return res;
+}
+
+size_t PaletteStorage::wordCount(size_t size, uint32_t bits)
+{
+	if (bits == 0)	return 0;
+	const size_t per_word = 32 / bits;
+	return (size + per_word - 1) / per_word;
+}
+
+uint32_t PaletteStorage::paletteIndex(Voxel v)
+{
+	auto it = std::find(_palette.begin(), _palette.end(), v);
+	if (it != _palette.end())
+		return uint32_t(it - _palette.begin());
+
+	if (_palette.size() == (size_t(1) << MaxPaletteBits))
+	{
+		// The palette is full, switch to direct storage
+		repack(DirectBits);
+		return uint32_t(v.id);
+	}
+	const uint32_t res = uint32_t(_palette.size());
+	_palette.push_back(v);
+	const uint32_t needed_bits = bitsFor(_palette.size());
+	if (needed_bits != _bits)
+		repack(needed_bits);
+	return res;
+}
+
+void PaletteStorage::repack(uint32_t new_bits)
+{
+	PaletteStorage res;
+	res._size = _size;
+	res._compressed = _compressed;
+	res._bits = new_bits;
+	res._words = std::vector<uint32_t>(wordCount(_size, new_bits), 0);
+	if (new_bits == DirectBits)
+	{
+		for (size_t i = 0; i < _size; ++i)
+			res._words[i] = uint32_t(get(i).id);
+		res._palette.clear();
+	}
+	else
+	{
+		// The palette only grew, the indices are still valid
+		res._palette = std::move(_palette);
+		if (_bits != 0)
+		{
+			for (size_t i = 0; i < _size; ++i)
+				res.setIndex(i, index(i));
+		}
+	}
+	*this = std::move(res);
+}
+
+void PaletteStorage::set(size_t i, Voxel v)
+{
+	if (_bits != DirectBits)
+	{
+		const uint32_t index = paletteIndex(v);
+		if (_bits != DirectBits)
+		{
+			if (_bits != 0)
+				setIndex(i, index);
+			return;
+		}
+	}
+	_words[i] = uint32_t(v.id);
+}
+
+void PaletteStorage::fill(Voxel v)
+{
+	if (!_compressed)
+	{
+		std::fill(_words.begin(), _words.end(), uint32_t(v.id));
+	}
+	else
+	{
+		// Also goes back to a palette if the storage had switched to direct
+		_bits = 0;
+		_palette = { v };
+		_words.clear();
+		_words.shrink_to_fit();
+	}
+}
+
+void PaletteStorage::assign(Voxel const* values)
+{
+	if (!_compressed)
+	{
+		_words.resize(_size);
+		for (size_t i = 0; i < _size; ++i)
+			_words[i] = uint32_t(values[i].id);
+		return;
+	}
+
+	if (_size == 0)
+		return;
+
+	// Palette indices of the small ids, the other ones are searched in the palette
+	constexpr size_t MaxPaletteSize = size_t(1) << MaxPaletteBits;
+	int16_t small_ids[MaxPaletteSize];
+	std::fill_n(small_ids, MaxPaletteSize, int16_t(-1));
+	thread_local std::vector<uint8_t> indices;
+	indices.resize(_size);
+	uint8_t* const idx = indices.data();
+
+	_palette.clear();
+	bool overflow = false;
+	for (size_t i = 0; i < _size; ++i)
+	{
+		const Voxel v = values[i];
+		int index;
+		if (uint32_t(v.id) < MaxPaletteSize)
+		{
+			index = small_ids[v.id];
+			if (index < 0)
+			{
+				index = int(_palette.size());
+				small_ids[v.id] = int16_t(index);
+				_palette.push_back(v);
+			}
+		}
+		else
+		{
+			index = int(std::find(_palette.begin(), _palette.end(), v) - _palette.begin());
+			if (index == int(_palette.size()))
+				_palette.push_back(v);
+		}
+		if (_palette.size() > MaxPaletteSize)
+		{
+			overflow = true;
+			break;
+		}
+		idx[i] = uint8_t(index);
+	}
+
+	if (overflow)
+	{
+		_palette.clear();
+		_bits = DirectBits;
+		_words.resize(_size);
+		for (size_t i = 0; i < _size; ++i)
+			_words[i] = uint32_t(values[i].id);
+		return;
+	}
+
+	_bits = bitsFor(_palette.size());
+	_words.assign(wordCount(_size, _bits), 0);
+	if (_bits == 0)
+		return;
+	const uint32_t per_word = 32 / _bits;
+	size_t i = 0;
+	for (uint32_t& word : _words)
+	{
+		uint32_t w = 0;
+		for (uint32_t k = 0; k < per_word && i < _size; ++k, ++i)
+			w |= uint32_t(idx[i]) << (k * _bits);
+		word = w;
+	}
+}
+
+void PaletteStorage::compact()
+{
+	if (!_compressed || _bits == 0 || _size == 0)
+		return;
+	PaletteStorage res(_size);
+	res.fill(get(0));
+	for (size_t i = 1; i < _size; ++i)
+		res.set(i, get(i));
+	*this = std::move(res);
+}
+
+bool PaletteStorage::uniform()const
+{
+	return _bits == 0;
+}
+
+size_t PaletteStorage::size()const
+{
+	return _size;
+}
+
+uint32_t PaletteStorage::bits()const
+{
+	return _bits;
+}
+
+bool PaletteStorage::direct()const
+{
+	return _bits == DirectBits;
+}
+
+std::vector<Voxel> const& PaletteStorage::palette()const
+{
+	return _palette;
+}
+
+std::vector<uint32_t> const& PaletteStorage::words()const
+{
+	return _words;
+}
+
+size_t PaletteStorage::memoryUsage()const
+{
+	return _palette.capacity() * sizeof(Voxel) + _words.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <voxels/Voxel.h>
+
+// Stores voxels as indices in a palette, bit packed in 32 bits words (a voxel never straddles two words).
+// The palette grows automatically: 1 entry -> 0 bits per voxel (uniform), then 1, 2, 4 and 8 bits.
+// Past 256 distinct values, the storage switches to 32 bits per voxel holding the id directly (no palette).
+class PaletteStorage
+{
+public:
+
+	static constexpr uint32_t MaxPaletteBits = 8;
+	static constexpr uint32_t DirectBits = 32;
+
+protected:
+
+	size_t _size;
+	bool _compressed;
+	uint32_t _bits;
+	std::vector<Voxel> _palette;
+	std::vector<uint32_t> _words;
+
+	static uint32_t bitsFor(size_t palette_size);
+
+	static size_t wordCount(size_t size, uint32_t bits);
+
+	// Finds or inserts v in the palette, may repack the words
+	uint32_t paletteIndex(Voxel v);
+
+	void repack(uint32_t new_bits);
+
+	uint32_t index(size_t i)const
+	{
+		const uint32_t per_word = 32 / _bits;
+		const uint32_t shift = uint32_t(i % per_word) * _bits;
+		return (_words[i / per_word] >> shift) & ((1u << _bits) - 1);
+	}
+
+	void setIndex(size_t i, uint32_t index)
+	{
+		const uint32_t per_word = 32 / _bits;
+		const uint32_t shift = uint32_t(i % per_word) * _bits;
+		const uint32_t mask = ((1u << _bits) - 1) << shift;
+		uint32_t& w = _words[i / per_word];
+		w = (w & ~mask) | (index << shift);
+	}
+
+public:
+
+	// direct: always store 32 bits per voxel (no compression)
+	PaletteStorage(size_t size = 0, bool direct = false);
+
+	Voxel get(size_t i)const
+	{
+		if (_bits == DirectBits)
+			return Voxel{ int32_t(_words[i]) };
+		if (_bits == 0)
+			return _palette[0];
+		return _palette[index(i)];
+	}
+
+	void set(size_t i, Voxel v);
+
+	void fill(Voxel v);
+
+	// Replaces the content with values[0, size()), building the smallest palette in a single pass
+	void assign(Voxel const* values);
+
+	// Rebuilds the palette with only the values in use (the palette never shrinks on its own)
+	// A storage holding a single value ends up with 0 bits per voxel
+	void compact();
+
+	// All the voxels have the same value
+	bool uniform()const;
+
+	size_t size()const;
+
+	// bits per voxel
+	uint32_t bits()const;
+
+	bool direct()const;
+
+	std::vector<Voxel> const& palette()const;
+
+	std::vector<uint32_t> const& words()const;
+
+	// host bytes used by the palette and the packed words
+	size_t memoryUsage()const;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <voxels/Chunk.h>
+
+struct Ray
+{
+	glm::vec3 origin;
+	// Does not need to be normalized
+	glm::vec3 direction;
+	float max_distance;
+};
+
+struct RayHit
+{
+	bool hit = false;
+	// World coordinates of the voxel
+	glm::ivec3 voxel = { 0, 0, 0 };
+	// Face of the voxel the ray entered through: axis * 2 + s (s: 0 -> +, 1 -> -), -1 if the ray starts inside it
+	int face = -1;
+	float distance = 0;
+	Voxel value = { 0 };
+};
+
+// Amanatides & Woo traversal of the voxels of the world, the chunk cid covering [cid * dims.xz, (cid + 1) * dims.xz) in x and z.
+// lookup(glm::ivec2 cid) -> Chunk const* (or any BasicChunk<Layout> const*), nullptr if the chunk is not loaded (crossed as empty).
+// The missing chunks and the uniform empty sections are crossed in a single step, the other voxels are tested
+// on the occupancy bits of their chunk.
+// Keeps the last chunk looked up, so an instance must not be shared between threads.
+template <class Lookup>
+class VoxelRaycaster
+{
+protected:
+
+	using ChunkPtr = decltype(std::declval<Lookup&>()(glm::ivec2{}));
+
+	glm::ivec3 _dims;
+	Lookup _lookup;
+
+	glm::ivec2 _cid;
+	ChunkPtr _chunk;
+	bool _cached;
+
+	static int floorDiv(int a, int b)
+	{
+		return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+	}
+
+	ChunkPtr chunk(glm::ivec2 cid)
+	{
+		if (!_cached || cid != _cid)
+		{
+			_cid = cid;
+			_chunk = _lookup(cid);
+			_cached = true;
+		}
+		return _chunk;
+	}
+
+	struct State
+	{
+		glm::vec3 origin, dir, inv;
+		glm::ivec3 step;
+		glm::ivec3 voxel;
+		glm::vec3 t_max, t_delta;
+		float t;
+		int axis;
+
+		void init(glm::ivec3 const& v)
+		{
+			voxel = v;
+			for (int a = 0; a < 3; ++a)
+			{
+				if (step[a] == 0)
+					t_max[a] = std::numeric_limits<float>::infinity();
+				else
+					t_max[a] = (float(voxel[a] + (step[a] > 0 ? 1 : 0)) - origin[a]) * inv[a];
+			}
+		}
+
+		// Moves to the first voxel after the box [box_min, box_max)
+		void leave(glm::ivec3 const& box_min, glm::ivec3 const& box_max)
+		{
+			float t_exit = std::numeric_limits<float>::infinity();
+			int exit_axis = 0;
+			for (int a = 0; a < 3; ++a)
+			{
+				if (step[a] == 0)
+					continue;
+				const float te = (float(step[a] > 0 ? box_max[a] : box_min[a]) - origin[a]) * inv[a];
+				if (te < t_exit)
+				{
+					t_exit = te;
+					exit_axis = a;
+				}
+			}
+			glm::ivec3 v;
+			for (int a = 0; a < 3; ++a)
+			{
+				if (a == exit_axis)
+					v[a] = step[a] > 0 ? box_max[a] : box_min[a] - 1;
+				else
+					v[a] = std::clamp(int(std::floor(origin[a] + dir[a] * t_exit)), box_min[a], box_max[a] - 1);
+			}
+			t = std::max(t, t_exit);
+			axis = exit_axis;
+			init(v);
+		}
+
+		void next()
+		{
+			const int a = t_max.x < t_max.y ? (t_max.x < t_max.z ? 0 : 2) : (t_max.y < t_max.z ? 1 : 2);
+			t = t_max[a];
+			voxel[a] += step[a];
+			t_max[a] += t_delta[a];
+			axis = a;
+		}
+	};
+
+public:
+
+	VoxelRaycaster(glm::ivec3 const& dims, Lookup const& lookup):
+		_dims(dims),
+		_lookup(lookup),
+		_cid(0, 0),
+		_chunk(nullptr),
+		_cached(false)
+	{}
+
+	RayHit cast(Ray const& ray)
+	{
+		RayHit res;
+		const float length = std::sqrt(glm::dot(ray.direction, ray.direction));
+		if (length == 0)
+			return res;
+
+		State s;
+		s.origin = ray.origin;
+		s.dir = ray.direction / length;
+		for (int a = 0; a < 3; ++a)
+		{
+			s.step[a] = s.dir[a] > 0 ? 1 : (s.dir[a] < 0 ? -1 : 0);
+			s.inv[a] = s.step[a] == 0 ? std::numeric_limits<float>::infinity() : 1.0f / s.dir[a];
+			s.t_delta[a] = std::abs(s.inv[a]);
+		}
+		s.t = 0;
+		s.axis = -1;
+		s.init(glm::ivec3(glm::floor(s.origin)));
+
+		// Starts above or below the world: straight to where it enters it
+		if (s.voxel.y < 0 || s.voxel.y >= _dims.y)
+		{
+			if ((s.voxel.y < 0) != (s.step.y > 0))
+				return res;
+			const int inf = std::numeric_limits<int>::max() / 2;
+			if (s.voxel.y < 0)
+				s.leave({ -inf, -inf, -inf }, { inf, 0, inf });
+			else
+				s.leave({ -inf, _dims.y, -inf }, { inf, inf, inf });
+		}
+
+		while (s.t <= ray.max_distance)
+		{
+			if (s.voxel.y < 0 || s.voxel.y >= _dims.y)
+				return res;
+			const glm::ivec2 cid = { floorDiv(s.voxel.x, _dims.x), floorDiv(s.voxel.z, _dims.z) };
+			const glm::ivec3 base = { cid.x * _dims.x, 0, cid.y * _dims.z };
+			ChunkPtr c = chunk(cid);
+			if (!c)
+			{
+				s.leave(base, base + _dims);
+				continue;
+			}
+			const glm::ivec3 local = s.voxel - base;
+			const int section = local.y / Chunk::SectionHeight;
+			PaletteStorage const& storage = c->section(section);
+			if (storage.uniform() && storage.palette()[0].id == 0)
+			{
+				const glm::ivec3 section_min = base + glm::ivec3(0, section * Chunk::SectionHeight, 0);
+				s.leave(section_min, section_min + glm::ivec3(_dims.x, Chunk::SectionHeight, _dims.z));
+				continue;
+			}
+			if (c->occupied(local))
+			{
+				res.hit = true;
+				res.voxel = s.voxel;
+				res.face = s.axis < 0 ? -1 : s.axis * 2 + (s.step[s.axis] > 0 ? 1 : 0);
+				res.distance = s.t;
+				res.value = (*c)(local);
+				return res;
+			}
+			s.next();
+		}
+		return res;
+	}
+
+	void cast(Ray const* rays, size_t n, RayHit* hits)
+	{
+		for (size_t i = 0; i < n; ++i)
+			hits[i] = cast(rays[i]);
+	}
+};
@@ -0,0 +1,300 @@
+#include <voxels/RegionFile.h>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+#include <cassert>
+
+RegionFile::RegionFile(std::filesystem::path const& path, glm::ivec3 chunk_dims):
+	_path(path),
+	_chunk_dims(chunk_dims),
+	_header{},
+	_exists(false)
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (file && file.read(reinterpret_cast<char*>(&_header), sizeof(Header)))
+	{
+		_exists = _header.magic == Magic && _header.version == Version
+			&& _header.dims[0] == chunk_dims.x && _header.dims[1] == chunk_dims.y && _header.dims[2] == chunk_dims.z;
+		if (!_exists)
+			std::cerr << "Ignoring the region file " << _path << ": incompatible header" << std::endl;
+	}
+	if (!_exists)
+	{
+		_header = Header{};
+		_header.magic = Magic;
+		_header.version = Version;
+		_header.dims[0] = chunk_dims.x;
+		_header.dims[1] = chunk_dims.y;
+		_header.dims[2] = chunk_dims.z;
+	}
+}
+
+int RegionFile::entryIndex(glm::ivec2 local)
+{
+	assert(local.x >= 0 && local.x < RegionSize && local.y >= 0 && local.y < RegionSize);
+	return local.x * RegionSize + local.y;
+}
+
+bool RegionFile::contains(glm::ivec2 local)
+{
+	std::shared_lock lock(_mutex);
+	return _header.entries[entryIndex(local)].size != 0;
+}
+
+bool RegionFile::load(glm::ivec2 local, Chunk& chunk)
+{
+	std::shared_lock lock(_mutex);
+	if (_header.entries[entryIndex(local)].size == 0)
+		return false;
+	while (!_map.isOpen())
+	{
+		// Opened lazily, and again after each save
+		lock.unlock();
+		{
+			std::unique_lock write_lock(_mutex);
+			if (!_map.isOpen() && !_map.open(_path))
+				return false;
+		}
+		lock.lock();
+	}
+	// Read once the lock is held for good: a save in between the locks above can have moved the chunk,
+	// and none can until the chunk is decoded
+	const Entry entry = _header.entries[entryIndex(local)];
+	if (entry.size == 0)
+		return false;
+	if (size_t(entry.offset) + entry.size > _map.size())
+		return false;
+	return decode(_map.data() + entry.offset, entry.size, chunk);
+}
+
+void RegionFile::save(glm::ivec2 local, std::vector<uint8_t> const& data)
+{
+	std::unique_lock lock(_mutex);
+	_map.close();
+
+	const int index = entryIndex(local);
+	Entry& entry = _header.entries[index];
+
+	std::fstream file;
+	if (_exists)
+		file.open(_path, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file.is_open())
+	{
+		file.open(_path, std::ios::binary | std::ios::out | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&_header), sizeof(Header));
+		_exists = true;
+	}
+	if (!file.is_open())
+	{
+		std::cerr << "Could not write the region file " << _path << std::endl;
+		return;
+	}
+
+	if (data.size() > entry.capacity)
+	{
+		// Does not fit its slot anymore: a new one at the end, with some room to grow
+		file.seekp(0, std::ios::end);
+		entry.offset = uint32_t(file.tellp());
+		entry.capacity = uint32_t(data.size() + data.size() / 4);
+	}
+	entry.size = uint32_t(data.size());
+
+	std::vector<uint8_t> slot(entry.capacity, 0);
+	std::memcpy(slot.data(), data.data(), data.size());
+	file.seekp(entry.offset);
+	file.write(reinterpret_cast<const char*>(slot.data()), slot.size());
+
+	file.seekp(offsetof(Header, entries) + index * sizeof(Entry));
+	file.write(reinterpret_cast<const char*>(&entry), sizeof(Entry));
+}
+
+void RegionFile::encode(Chunk const& chunk, std::vector<uint8_t>& res)
+{
+	const glm::ivec3 dims = chunk.dims();
+	res.clear();
+	const auto push = [&res](uint16_t value)
+	{
+		res.push_back(uint8_t(value & 0xff));
+		res.push_back(uint8_t(value >> 8));
+	};
+	for (int x = 0; x < dims.x; ++x)
+	{
+		for (int z = 0; z < dims.z; ++z)
+		{
+			Voxel current = chunk.section(0).get(chunk.localId(x, 0, z));
+			int length = 0;
+			const auto extend = [&](Voxel v, int n)
+			{
+				if (!(v == current))
+				{
+					assert(current.id >= 0 && current.id <= 0xffff);
+					push(uint16_t(length));
+					push(uint16_t(current.id));
+					current = v;
+					length = 0;
+				}
+				length += n;
+			};
+			for (int s = 0; s < chunk.sectionCount(); ++s)
+			{
+				const PaletteStorage& section = chunk.section(s);
+				// A uniform section extends the run at once
+				if (section.uniform())
+				{
+					extend(section.palette()[0], Chunk::SectionHeight);
+					continue;
+				}
+				for (int y = 0; y < Chunk::SectionHeight; ++y)
+					extend(section.get(chunk.localId(x, y, z)), 1);
+			}
+			assert(current.id >= 0 && current.id <= 0xffff);
+			push(uint16_t(length));
+			push(uint16_t(current.id));
+		}
+	}
+}
+
+bool RegionFile::decode(const uint8_t* data, size_t size, Chunk& chunk)
+{
+	const glm::ivec3 dims = chunk.dims();
+	const int columns = dims.x * dims.z;
+
+	struct Run
+	{
+		int end;
+		Voxel v;
+	};
+
+	// Runs of all the columns, then each section is either filled at once (if it is inside a single run of the same value
+	// in every column) or decoded in a buffer and packed
+	thread_local std::vector<Run> runs;
+	thread_local std::vector<uint32_t> column_runs;
+	thread_local std::vector<Voxel> values;
+	runs.clear();
+	column_runs.resize(columns);
+
+	const uint8_t* const end = data + size;
+	const auto read = [&data]()
+	{
+		const uint16_t res = uint16_t(data[0]) | (uint16_t(data[1]) << 8);
+		data += 2;
+		return res;
+	};
+	for (int c = 0; c < columns; ++c)
+	{
+		column_runs[c] = uint32_t(runs.size());
+		int y = 0;
+		while (y < dims.y)
+		{
+			if (end - data < 4)
+				return false;
+			const int length = read();
+			const Voxel v = { int32_t(read()) };
+			if (length == 0 || y + length > dims.y)
+				return false;
+			y += length;
+			runs.push_back({ y, v });
+		}
+	}
+	if (data != end)
+		return false;
+
+	// Cursor of each column in runs, advanced section by section
+	thread_local std::vector<uint32_t> cursors;
+	cursors = column_runs;
+	for (int s = 0; s < chunk.sectionCount(); ++s)
+	{
+		const int y0 = s * Chunk::SectionHeight;
+		const int y1 = y0 + Chunk::SectionHeight;
+		for (int c = 0; c < columns; ++c)
+		{
+			while (runs[cursors[c]].end <= y0)
+				++cursors[c];
+		}
+
+		const Voxel first = runs[cursors[0]].v;
+		bool uniform = true;
+		for (int c = 0; c < columns && uniform; ++c)
+		{
+			const Run& run = runs[cursors[c]];
+			uniform = run.end >= y1 && run.v == first;
+		}
+		if (uniform)
+		{
+			chunk.fillSection(s, first);
+			continue;
+		}
+
+		values.resize(chunk.sectionSize());
+		for (int c = 0; c < columns; ++c)
+		{
+			const int x = c / dims.z, z = c % dims.z;
+			uint32_t r = cursors[c];
+			for (int y = y0; y < y1; ++y)
+			{
+				if (runs[r].end <= y)
+					++r;
+				values[chunk.localId(x, y - y0, z)] = runs[r].v;
+			}
+		}
+		chunk.assignSection(s, values.data());
+	}
+	return true;
+}
+
+
+
+RegionStore::RegionStore(std::filesystem::path const& directory, glm::ivec3 chunk_dims):
+	_directory(directory),
+	_chunk_dims(chunk_dims)
+{
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error)
+		std::cerr << "Could not create the directory " << _directory << ": " << error.message() << std::endl;
+}
+
+glm::ivec2 RegionStore::regionId(glm::ivec2 cid)
+{
+	// floor division
+	const auto div = [](int a)
+	{
+		return a >= 0 ? a / RegionFile::RegionSize : -((-a - 1) / RegionFile::RegionSize) - 1;
+	};
+	return { div(cid.x), div(cid.y) };
+}
+
+std::filesystem::path RegionStore::regionPath(glm::ivec2 rid)const
+{
+	return _directory / ("r." + std::to_string(rid.x) + "." + std::to_string(rid.y) + ".vxr");
+}
+
+RegionFile& RegionStore::region(glm::ivec2 rid)
+{
+	std::unique_lock lock(_mutex);
+	std::unique_ptr<RegionFile>& res = _regions[rid];
+	if (!res)
+		res = std::make_unique<RegionFile>(regionPath(rid), _chunk_dims);
+	return *res;
+}
+
+bool RegionStore::contains(glm::ivec2 cid)
+{
+	const glm::ivec2 rid = regionId(cid);
+	return region(rid).contains(cid - rid * RegionFile::RegionSize);
+}
+
+bool RegionStore::load(glm::ivec2 cid, Chunk& chunk)
+{
+	const glm::ivec2 rid = regionId(cid);
+	return region(rid).load(cid - rid * RegionFile::RegionSize, chunk);
+}
+
+void RegionStore::save(glm::ivec2 cid, Chunk const& chunk)
+{
+	thread_local std::vector<uint8_t> data;
+	RegionFile::encode(chunk, data);
+	const glm::ivec2 rid = regionId(cid);
+	region(rid).save(cid - rid * RegionFile::RegionSize, data);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <shared_mutex>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <voxels/Chunk.h>
+#include <voxels/ChunkMap.h>
+#include <voxels/MappedFile.h>
+
+// A region file stores RegionSize x RegionSize chunks:
+// - a header: magic, version, chunk dimensions, then a table of RegionSize^2 entries (offset, size, capacity) in bytes,
+//   an entry with size 0 is a chunk that was never saved
+// - the chunks, each in its own slot of the file: a chunk is rewritten in place if it fits its slot, appended otherwise
+// A chunk is compressed with a run length encoding along y: for each column (x major, then z),
+// (length, id) pairs of uint16 covering the whole height.
+// The reads go through a memory mapping of the file, the writes through a regular stream (the mapping is closed then).
+// Thread safe: any number of concurrent loads, a save blocks the loads of the same region.
+class RegionFile
+{
+public:
+
+	static constexpr int RegionSize = 32;
+
+	static constexpr uint32_t Magic = 0x47525856; // "VXRG"
+	static constexpr uint32_t Version = 1;
+
+	struct Entry
+	{
+		uint32_t offset, size, capacity;
+	};
+
+	struct Header
+	{
+		uint32_t magic, version;
+		int32_t dims[3];
+		Entry entries[RegionSize * RegionSize];
+	};
+
+protected:
+
+	std::filesystem::path _path;
+	glm::ivec3 _chunk_dims;
+
+	std::shared_mutex _mutex;
+	Header _header;
+	bool _exists;
+	MappedFile _map;
+
+	static int entryIndex(glm::ivec2 local);
+
+public:
+
+	RegionFile(std::filesystem::path const& path, glm::ivec3 chunk_dims);
+
+	RegionFile(RegionFile const&) = delete;
+
+	bool contains(glm::ivec2 local);
+
+	// Returns false if the chunk is not in the file (chunk is unchanged then)
+	bool load(glm::ivec2 local, Chunk& chunk);
+
+	// data from encode
+	void save(glm::ivec2 local, std::vector<uint8_t> const& data);
+
+	static void encode(Chunk const& chunk, std::vector<uint8_t>& res);
+
+	// Returns false if data is not a valid encoding of a chunk of the dimensions of chunk
+	static bool decode(const uint8_t* data, size_t size, Chunk& chunk);
+};
+
+// All the region files of a world, in one directory. Thread safe.
+class RegionStore
+{
+protected:
+
+	std::filesystem::path _directory;
+	glm::ivec3 _chunk_dims;
+
+	std::mutex _mutex;
+	// By region id
+	std::unordered_map<glm::ivec2, std::unique_ptr<RegionFile>> _regions;
+
+	RegionFile& region(glm::ivec2 rid);
+
+public:
+
+	RegionStore(std::filesystem::path const& directory, glm::ivec3 chunk_dims);
+
+	static glm::ivec2 regionId(glm::ivec2 cid);
+
+	std::filesystem::path regionPath(glm::ivec2 rid)const;
+
+	bool contains(glm::ivec2 cid);
+
+	bool load(glm::ivec2 cid, Chunk& chunk);
+
+	void save(glm::ivec2 cid, Chunk const& chunk);
+};
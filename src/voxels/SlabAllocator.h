@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+// Blocks of BlockSize bytes carved from slabs of about SlabBytes, recycled through a free list instead of going back
+// to the heap, so that loading and unloading chunks of the same size does not fragment it.
+// One allocator per block size (instance()), thread safe since the chunks are built by the jobs.
+template <size_t BlockSize, size_t Alignment = alignof(std::max_align_t)>
+class SlabAllocator
+{
+public:
+
+	static constexpr size_t SlabBytes = size_t(1) << 20;
+
+	static constexpr size_t BlockStride = (BlockSize + Alignment - 1) / Alignment * Alignment;
+
+	static constexpr size_t BlocksPerSlab = std::max<size_t>(1, SlabBytes / BlockStride);
+
+protected:
+
+	struct alignas(Alignment) Block
+	{
+		std::byte bytes[BlockStride];
+	};
+
+	mutable std::mutex _mutex;
+	std::vector<std::unique_ptr<Block[]>> _slabs;
+	std::vector<void*> _free;
+
+public:
+
+	SlabAllocator() = default;
+
+	SlabAllocator(SlabAllocator const&) = delete;
+
+	static SlabAllocator& instance()
+	{
+		static SlabAllocator res;
+		return res;
+	}
+
+	void* acquire()
+	{
+		std::unique_lock lock(_mutex);
+		if (_free.empty())
+		{
+			_slabs.push_back(std::make_unique<Block[]>(BlocksPerSlab));
+			Block* slab = _slabs.back().get();
+			for (size_t i = BlocksPerSlab; i > 0; --i)
+				_free.push_back(slab + (i - 1));
+		}
+		void* res = _free.back();
+		_free.pop_back();
+		return res;
+	}
+
+	// block must come from acquire
+	void release(void* block)
+	{
+		std::unique_lock lock(_mutex);
+		_free.push_back(block);
+	}
+
+	size_t slabCount()const
+	{
+		std::unique_lock lock(_mutex);
+		return _slabs.size();
+	}
+
+	size_t freeBlocks()const
+	{
+		std::unique_lock lock(_mutex);
+		return _free.size();
+	}
+};
+
+// std::array like storage of N T, held in a block of the SlabAllocator of its size (so it moves as a pointer).
+// Takes the same constructor as std::vector(n, value) so that it can stand for one when N is known at compile time.
+template <class T, size_t N>
+class SlabArray
+{
+public:
+
+	static_assert(std::is_trivially_destructible_v<T>);
+
+	using Allocator = SlabAllocator<sizeof(T) * N, std::max(alignof(T), alignof(std::max_align_t))>;
+
+protected:
+
+	T* _data;
+
+public:
+
+	SlabArray(size_t n = N, T const& value = T()) :
+		_data(static_cast<T*>(Allocator::instance().acquire()))
+	{
+		assert(n == N);
+		std::uninitialized_fill_n(_data, N, value);
+	}
+
+	SlabArray(SlabArray const&) = delete;
+
+	SlabArray(SlabArray&& other) noexcept :
+		_data(other._data)
+	{
+		other._data = nullptr;
+	}
+
+	SlabArray& operator=(SlabArray&& other) noexcept
+	{
+		std::swap(_data, other._data);
+		return *this;
+	}
+
+	~SlabArray()
+	{
+		if (_data)
+			Allocator::instance().release(_data);
+	}
+
+	static constexpr size_t size()
+	{
+		return N;
+	}
+
+	T* data()
+	{
+		return _data;
+	}
+
+	T const* data()const
+	{
+		return _data;
+	}
+
+	T& operator[](size_t i)
+	{
+		return _data[i];
+	}
+
+	T const& operator[](size_t i)const
+	{
+		return _data[i];
+	}
+
+	T* begin()
+	{
+		return _data;
+	}
+
+	T* end()
+	{
+		return _data + N;
+	}
+
+	T const* begin()const
+	{
+		return _data;
+	}
+
+	T const* end()const
+	{
+		return _data + N;
+	}
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+#include <voxels/ChunkMap.h>
+
+// Values of T per world column (x, z), cached in square tiles of TileSize columns filled at once by a generator
+// (so a batched noise evaluation covers a whole tile). At most maxTiles() tiles are kept, the least recently used
+// one being dropped beyond. Thread safe: the tiles are shared, a tile being read by a thread while it is dropped
+// stays alive until the read is done. Two threads missing the same tile may both generate it, only one is kept.
+template <class T>
+class TileCache
+{
+public:
+
+	static constexpr int TileSize = 64;
+
+	// Writes the values of the columns [first, first + TileSize)^2 to res[i * TileSize + j] for the column first + (i, j)
+	using Generator = std::function<void(glm::ivec2 first, T* res)>;
+
+protected:
+
+	using Tile = std::vector<T>;
+
+	struct Entry
+	{
+		std::shared_ptr<const Tile> tile;
+		// Position in _lru
+		typename std::list<glm::ivec2>::iterator lru;
+	};
+
+	Generator _generator;
+	size_t _max_tiles;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<glm::ivec2, Entry> _tiles;
+	// Most recently used first
+	std::list<glm::ivec2> _lru;
+
+	std::atomic<size_t> _hits, _misses;
+
+	static int floorDiv(int a, int b)
+	{
+		return (a >= 0 ? a : a - b + 1) / b;
+	}
+
+	std::shared_ptr<const Tile> tile(glm::ivec2 tid)
+	{
+		{
+			std::unique_lock lock(_mutex);
+			auto it = _tiles.find(tid);
+			if (it != _tiles.end())
+			{
+				_lru.splice(_lru.begin(), _lru, it->second.lru);
+				++_hits;
+				return it->second.tile;
+			}
+		}
+		++_misses;
+		// Generated out of the lock, so that the other tiles can be read meanwhile
+		auto res = std::make_shared<Tile>(size_t(TileSize) * TileSize);
+		_generator(tid * TileSize, res->data());
+
+		std::unique_lock lock(_mutex);
+		auto [it, inserted] = _tiles.try_emplace(tid);
+		if (!inserted)
+		{
+			_lru.splice(_lru.begin(), _lru, it->second.lru);
+			return it->second.tile;
+		}
+		_lru.push_front(tid);
+		it->second = Entry{ std::move(res), _lru.begin() };
+		std::shared_ptr<const Tile> shared = it->second.tile;
+		while (_tiles.size() > _max_tiles)
+		{
+			_tiles.erase(_lru.back());
+			_lru.pop_back();
+		}
+		return shared;
+	}
+
+public:
+
+	TileCache(Generator generator, size_t max_tiles = 256) :
+		_generator(std::move(generator)),
+		_max_tiles(std::max<size_t>(max_tiles, 1)),
+		_hits(0),
+		_misses(0)
+	{}
+
+	TileCache(TileCache const&) = delete;
+
+	T get(glm::ivec2 column)
+	{
+		const glm::ivec2 tid = { floorDiv(column.x, TileSize), floorDiv(column.y, TileSize) };
+		const glm::ivec2 local = column - tid * TileSize;
+		return (*tile(tid))[size_t(local.x) * TileSize + local.y];
+	}
+
+	// The columns [first, first + size), res[i * size.y + j] for the column first + (i, j)
+	void get(glm::ivec2 first, glm::ivec2 size, T* res)
+	{
+		const glm::ivec2 last = first + size - 1;
+		for (int tx = floorDiv(first.x, TileSize); tx <= floorDiv(last.x, TileSize); ++tx)
+		{
+			for (int tz = floorDiv(first.y, TileSize); tz <= floorDiv(last.y, TileSize); ++tz)
+			{
+				const glm::ivec2 tile_first = glm::ivec2{ tx, tz } * TileSize;
+				const std::shared_ptr<const Tile> t = tile({ tx, tz });
+				// Intersection of the tile and the requested columns
+				const glm::ivec2 begin = glm::max(first, tile_first);
+				const glm::ivec2 end = glm::min(last + 1, tile_first + TileSize);
+				for (int x = begin.x; x < end.x; ++x)
+				{
+					const T* src = t->data() + size_t(x - tile_first.x) * TileSize + (begin.y - tile_first.y);
+					std::copy(src, src + (end.y - begin.y), res + size_t(x - first.x) * size.y + (begin.y - first.y));
+				}
+			}
+		}
+	}
+
+	void clear()
+	{
+		std::unique_lock lock(_mutex);
+		_tiles.clear();
+		_lru.clear();
+	}
+
+	size_t maxTiles()const
+	{
+		return _max_tiles;
+	}
+
+	size_t tileCount()const
+	{
+		std::unique_lock lock(_mutex);
+		return _tiles.size();
+	}
+
+	size_t hits()const
+	{
+		return _hits;
+	}
+
+	size_t misses()const
+	{
+		return _misses;
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+struct Voxel
+{
+	int32_t id;
+
+	constexpr bool operator==(Voxel const& other)const = default;
+};
+
+// Per block type properties, same layout as the Props uniform block of the voxel shaders
+struct Property
+{
+	static constexpr int32_t OpaqueFlag = 1;
+
+	// Bits [EmissionShift, EmissionShift + 4) of the flag: block light emitted (0 to 15)
+	static constexpr int32_t EmissionShift = 8;
+
+	int32_t flag;
+	// +x, -x, +y, -y, +z, -z
+	int32_t face_ids[6];
+	int32_t _pad;
+};
+
+// Opacity of each block type by id, the ids past the properties are opaque (except 0)
+using OpaqueTable = std::array<bool, 256>;
+
+inline OpaqueTable makeOpaqueTable(std::vector<Property> const& properties)
+{
+	OpaqueTable res;
+	for (size_t i = 0; i < res.size(); ++i)
+		res[i] = i < properties.size() ? bool(properties[i].flag & Property::OpaqueFlag) : (i != 0);
+	return res;
+}
+
+// Block light emitted by each block type by id
+using EmissionTable = std::array<uint8_t, 256>;
+
+inline EmissionTable makeEmissionTable(std::vector<Property> const& properties)
+{
+	EmissionTable res;
+	for (size_t i = 0; i < res.size(); ++i)
+		res[i] = i < properties.size() ? uint8_t((properties[i].flag >> Property::EmissionShift) & 15) : 0;
+	return res;
+}
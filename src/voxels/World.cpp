@@ -1,80 +1,12 @@
 #include <voxels/World.h>
 #include <numbers>
 #include <algorithm>
+#include <numeric>
 #include <lib/Transforms.h>
 #include <lib/ShaderDesc.h>
 #include <lib/ProgramDesc.h>
 #include <lib/Material.h>
-
-namespace perlin
-{
-	/* Function to linearly interpolate between a0 and a1
- * Weight w should be in the range [0.0, 1.0]
- */
-	float interpolate(float a0, float a1, float w) {
-		 //// You may want clamping by inserting:
-		 // if (0.0 > w) return a0;
-		 // if (1.0 < w) return a1;
-		 //
-		//return (a1 - a0) * w + a0;
-		 // Use this cubic interpolation [[Smoothstep]] instead, for a smooth appearance:
-		//return (a1 - a0) * (3.0 - w * 2.0) * w * w + a0;
-		
-		// Use [[Smootherstep]] for an even smoother result with a second derivative equal to zero on boundaries:
-		return (a1 - a0) * ((w * (w * 6.0 - 15.0) + 10.0) * w * w * w) + a0;
-		 
-	}
-
-	/* Create random direction vector
-	 */
-	glm::vec2 randomGradient(int ix, int iy) {
-		// Random float. No precomputed gradients mean this works for any number of grid coordinates
-		float random = 2920.f * sin(ix * 21942.f + iy * 171324.f + 8912.f) * cos(ix * 23157.f * iy * 217832.f + 9758.f);
-		return glm::vec2{cos(random), sin(random) };
-	}
-
-	// Computes the dot product of the distance and gradient vectors.
-	float dotGridGradient(int ix, int iy, float x, float y) {
-		// Get gradient from integer coordinates
-		glm::vec2 gradient = randomGradient(ix, iy);
-
-		// Compute the distance vector
-		float dx = x - (float)ix;
-		float dy = y - (float)iy;
-
-		// Compute the dot-product
-		return (dx * gradient.x + dy * gradient.y);
-	}
-
-	// Compute Perlin noise at coordinates x, y
-	float perlin(float x, float y) {
-		// Determine grid cell coordinates
-		int x0 = (int)x;
-		int x1 = x0 + 1;
-		int y0 = (int)y;
-		int y1 = y0 + 1;
-
-		// Determine interpolation weights
-		// Could also use higher order polynomial/s-curve here
-		float sx = x - (float)x0;
-		float sy = y - (float)y0;
-
-		// Interpolate between grid point gradients
-		float n0, n1, ix0, ix1, value;
-
-		n0 = dotGridGradient(x0, y0, x, y);
-		n1 = dotGridGradient(x1, y0, x, y);
-		ix0 = interpolate(n0, n1, sx);
-
-		n0 = dotGridGradient(x0, y1, x, y);
-		n1 = dotGridGradient(x1, y1, x, y);
-		ix1 = interpolate(n0, n1, sx);
-
-		value = interpolate(ix0, ix1, sy);
-		return value;
-	}
-}
-
+#include <chrono>
 
 template <class T, int N>
 T distanceTchebychev(lib::Vector<N, T> const& a, lib::Vector<N, T> const& b)
@@ -89,96 +21,46 @@ T distanceTchebychev(lib::Vector<N, T> const& a, lib::Vector<N, T> const& b)
 }
 
 
-_NODISCARD size_t std::hash<glm::ivec2>::operator()(glm::ivec2 const& cid) const noexcept
-{
-	return size_t(cid.x) << 32 + size_t(cid.y);
-}
-
-
-World::GridRayMarcher::GridRayMarcher(glm::vec2 const& source, glm::vec2 const& dir) :
-	_vertical(std::abs(dir.x) > std::cos(std::numbers::pi / 4.0)),
-	_pos(source),
-	_dir_normalized(dir)
-{
-	if (_vertical)
-	{
-		_dir = _dir_normalized / std::abs(_dir_normalized.x);
-	}
-	else
-	{
-		_dir = _dir_normalized / std::abs(_dir_normalized.y);
-	}
-}
-
-World::GridRayMarcher::GridRayMarcher(glm::vec2 const& source, glm::vec2 const& dir, bool vertical) :
-	_vertical(vertical),
-	_pos(source),
-	_dir_normalized(dir)
-{
-	if (_vertical)
-	{
-		_dir = _dir_normalized / std::abs(_dir_normalized.x);
-	}
-	else
-	{
-		_dir = _dir_normalized / std::abs(_dir_normalized.y);
-	}
-
-	tan_alpha = _vertical ? (_dir_normalized.y / _dir_normalized.x) : (_dir_normalized.x / _dir_normalized.y);
-}
-
-void World::GridRayMarcher::firstStep()
-{
-	if (_vertical)
-	{
-		bool right = _dir_normalized.x > 0;
-		float target = right ? std::ceil(_pos.x) : std::floor(_pos.x);
-		float dx = target - _pos.x;
-		float dy = dx * tan_alpha;
-
-		_pos += glm::vec2(dx, dy);
-		_pos.y = std::round(_pos.y);
-	}
-	else
-	{
-		bool up = _dir_normalized.y > 0;
-		float target = up ? std::ceil(_pos.y) : std::floor(_pos.y);
-		float dy = target - _pos.y;
-		float dx = dy * tan_alpha;
-
-		_pos += glm::vec2(dx, dy);
-		_pos.x = std::round(_pos.x);
-	}
-}
-
-void World::GridRayMarcher::stepOne()
-{
-	_pos += _dir;
-}
-
-glm::ivec2 World::GridRayMarcher::getId()const
-{
-	glm::ivec2 res;
-	if (_vertical)
-	{
-		res = { _pos.x + 0.5, _pos.y };
-		bool right = _dir_normalized.x > 0;
-		if (!right) --res.x;
-	}
-	else
-	{
-		res = { _pos.x, _pos.y + 0.5 };
-		bool up = _dir_normalized.y > 0;
-		if (!up)	--res.y;
-	}
-	return res;
-}
-
-World::World(glm::ivec3 chunk_size) :
-	_chunk_size(chunk_size)
+World::World(glm::ivec3 chunk_size, unsigned int n_workers) :
+	_streaming_stats{},
+	_jobs(std::make_unique<JobSystem>(n_workers)),
+	_disk_loads(0),
+	_disk_load_ns(0),
+	_generations(0),
+	_generation_ns(0),
+	_total_generated_chunks(0),
+	_total_unloaded_chunks(0),
+	_frame(0),
+	_unload_margin(2),
+	_memory_budget(size_t(1) << 30),
+	_mesh_all(false),
+	_edit_batch(0),
+	_column_cache([this](glm::ivec2 first, ColumnInfo* res) { generateColumns(first, glm::ivec2(TileCache<ColumnInfo>::TileSize), res); }),
+	_meshing_ns(0),
+	_meshed_chunks(0),
+	_face_building_ns(0),
+	_lighting_ns(0),
+	_edit_lighting_ns(0),
+	_edit_lit_chunks(0),
+	_incremental_lit_chunks(0),
+	_renderer(Renderer::Faces),
+	_render_stats{},
+	_queries_pending{},
+	_query_frame(0),
+	_chunk_size(chunk_size),
+	_frustum_culling(true),
+	_cull_stats{},
+	_cave_culling(true),
+	_cave_frame(0),
+	_horizon_culling(true),
+	_multi_draw(true)
 {
-	_load_radius = 6;
-	_draw_distance = 6;
+	_opaque = makeOpaqueTable(_properties);
+	_emission = makeEmissionTable(_properties);
+	// The chunks beyond 6 are drawn with the LOD levels, and only meshed at full resolution up to meshRadius()
+	_load_radius = 32;
+	_draw_distance = 32;
+	_lod_distances = { 6, 12, 18 };
 
 
 	_ids_buffer = std::vector<glm::ivec3>(_chunk_size.x * _chunk_size.y * _chunk_size.z);
@@ -205,8 +87,139 @@ World::World(glm::ivec3 chunk_size) :
 
 
 	_vox_prog = std::make_shared<lib::ProgramDesc>(lib::Material::shaderPath().string() + "voxel", true);
-	_vox_prog->link();
+	// All the chunks have the same dimensions: constants of the shaders rather than uniforms
+	_vox_prog->link({
+		"VOXEL_LAYOUT " + std::to_string(Chunk::LayoutType::Id),
+		"GRID_DIMS ivec3(" + std::to_string(_chunk_size.x) + ", " + std::to_string(_chunk_size.y) + ", " + std::to_string(_chunk_size.z) + ")",
+		"SECTION_HEIGHT " + std::to_string(Chunk::SectionHeight),
+	});
+
+	_mesh_prog = std::make_shared<lib::ProgramDesc>(
+		std::make_shared<lib::ShaderDesc>(lib::Material::shaderPath().string() + "voxel_mesh.vert", GL_VERTEX_SHADER),
+		std::make_shared<lib::ShaderDesc>(lib::Material::shaderPath().string() + "voxel.frag", GL_FRAGMENT_SHADER)
+	);
+	_mesh_prog->link();
+
+	_faces_prog = std::make_shared<lib::ProgramDesc>(
+		std::make_shared<lib::ShaderDesc>(lib::Material::shaderPath().string() + "voxel_faces.vert", GL_VERTEX_SHADER),
+		std::make_shared<lib::ShaderDesc>(lib::Material::shaderPath().string() + "voxel.frag", GL_FRAGMENT_SHADER)
+	);
+	// The faces carry their light (see FaceStream.h)
+	_faces_prog->link({ "VOXEL_LIGHT" });
+
+	glGenQueries(2 * QueryFrames, &_queries[0][0]);
+	glCreateBuffers(3, _draw_buffers);
+}
+
+World::~World()
+{
+	// The jobs use many members declared after _jobs (builders, noise, caches, regions, counters):
+	// the workers are joined (the waiting jobs dropped) before any of them is destroyed
+	_jobs.reset();
+	if (_regions)
+		saveAll();
+	glDeleteQueries(2 * QueryFrames, &_queries[0][0]);
+	glDeleteBuffers(3, _draw_buffers);
+}
+
+void World::setSaveDirectory(std::filesystem::path const& directory)
+{
+	_regions = std::make_unique<RegionStore>(directory, _chunk_size);
+	_save_jobs = std::make_unique<JobSystem>(1);
+}
+
+void World::saveAll()
+{
+	if (!_regions)
+		return;
+	_chunks.forEach([&](ChunkHandle, glm::ivec2 cid, LoadedChunk& loaded)
+		{
+			if (loaded.modified || !loaded.on_disk)
+			{
+				const Chunk* chunk = &loaded.chunk;
+				_save_jobs->submit([this, cid, chunk]()
+					{
+						_regions->save(cid, *chunk);
+					}
+				);
+				loaded.on_disk = true;
+				loaded.modified = false;
+			}
+		}
+	);
+	// Also makes the chunk pointers safe to use by the jobs above
+	_save_jobs->wait();
+	_saved_chunks.consumeAll([&](glm::ivec2&& cid)
+		{
+			_saving_chunks.erase(cid);
+		}
+	);
+}
+
+void World::setProperties(std::vector<Property> const& properties)
+{
+	_properties = properties;
+	_opaque = makeOpaqueTable(properties);
+	_emission = makeEmissionTable(properties);
+	_mesher = GreedyMesher(properties);
+	_face_builder = FaceBuilder(properties);
+	_lod_builder = LodBuilder(properties);
+	_light_builder = LightBuilder(properties);
+}
+
+bool World::isOpaque(Voxel v)const
+{
+	if (v.id == 0)
+		return false;
+	if (size_t(v.id) >= _properties.size())
+		return true;
+	return _properties[v.id].flag & Property::OpaqueFlag;
+}
+
+World::ColumnInfo World::columnInfoFromNoise(float p)const
+{
+	ColumnInfo res;
+	float h = p + 128;
+	h = std::clamp(h, 0.0f, float(_chunk_size.y));
+	res.dirt_start = h;
+	res.dirt_height = 6;
+	return res;
+}
+
+void World::generateColumns(glm::ivec2 first, glm::ivec2 size, ColumnInfo* res)const
+{
+	const int n = size.x * size.y;
+	thread_local std::vector<float> noise;
+	noise.resize(n);
+	_noise.sampleGrid((first.x + 0.5f) * NoiseScale, (first.y + 0.5f) * NoiseScale, NoiseScale, size.x, size.y, noise.data());
+	for (int i = 0; i < n; ++i)
+		res[i] = columnInfoFromNoise(noise[i]);
+}
+
+void World::generateColumnInfos(glm::ivec2 cid, ColumnInfo* res)const
+{
+	generateColumns(cid * glm::ivec2(_chunk_size.x, _chunk_size.z), { _chunk_size.x, _chunk_size.z }, res);
+}
+
+World::ColumnInfo World::columnInfo(glm::ivec2 column)const
+{
+	return _column_cache.get(column);
+}
+
+void World::columnInfos(glm::ivec2 cid, ColumnInfo* res)const
+{
+	_column_cache.get(cid * glm::ivec2(_chunk_size.x, _chunk_size.z), { _chunk_size.x, _chunk_size.z }, res);
+}
 
+int World::terrainHeight(glm::ivec2 column)const
+{
+	const ColumnInfo clm = columnInfo(column);
+	return std::min(clm.dirt_start + clm.dirt_height + 1, _chunk_size.y);
+}
+
+TileCache<World::ColumnInfo> const& World::columnCache()const
+{
+	return _column_cache;
 }
 
 World::ColumnInfo World::generateColumnInfo(glm::ivec2 cid)const
@@ -215,12 +228,7 @@ World::ColumnInfo World::generateColumnInfo(glm::ivec2 cid)const
 	bool use_perlin = true;
 	if (use_perlin)
 	{
-		float scale = 0.05;
-		float p = perlin::perlin((cid.x + 0.5) * scale, (cid.y + 0.5) * scale);
-		float h = p + 128;
-		h = std::clamp(h, 0.0f, float(_chunk_size.y));
-		res.dirt_start = h;
-		res.dirt_height = 6;
+		res = columnInfoFromNoise(_noise.sample((cid.x + 0.5f) * NoiseScale, (cid.y + 0.5f) * NoiseScale));
 	}
 	else
 	{
@@ -234,34 +242,56 @@ World::ColumnInfo World::generateColumnInfo(glm::ivec2 cid)const
 	return res;
 }
 
-void World::fillChunk(glm::ivec2 cid)
+void World::fillChunk(Chunk& c, glm::ivec2 cid)const
 {
-	Chunk& c = _chunks[cid];
-	std::memset(&c[0], c.byteSize(), 0);
-	for (int i = 0; i < _chunk_size.x; ++i)
+	thread_local std::vector<ColumnInfo> columns;
+	thread_local std::vector<Voxel> values;
+	columns.resize(_chunk_size.x * _chunk_size.z);
+	columnInfos(cid, columns.data());
+
+	// A column is 4 runs: stone [0, dirt_start), dirt [dirt_start, top), grass at top, then air
+	int lowest_dirt = _chunk_size.y, highest_top = 0;
+	for (ColumnInfo const& clm : columns)
 	{
-		for (int j = 0; j < _chunk_size.z; ++j)
-		{
-			glm::ivec2 c_column = { i, j };
-			glm::ivec2 w_column = cid * glm::ivec2(_chunk_size.x, _chunk_size.z) + c_column;
-			ColumnInfo clm = generateColumnInfo(w_column);
-			glm::ivec3 idx = { i, 0, j };
-
-			for (int k = 0; k < clm.dirt_start; ++k)
-			{
-				idx.y = k;
-				c(idx) = Voxel{ 1 };
-			}
+		lowest_dirt = std::min(lowest_dirt, clm.dirt_start);
+		highest_top = std::max(highest_top, clm.dirt_start + clm.dirt_height);
+	}
 
-			for (int k = clm.dirt_start; k < clm.dirt_start + clm.dirt_height; ++k)
+	// Most of the sections are uniform (air or stone) and filled at once, the other ones are written
+	// run by run in a buffer and packed once
+	values.resize(c.sectionSize());
+	for (int s = 0; s < c.sectionCount(); ++s)
+	{
+		const int y0 = s * Chunk::SectionHeight;
+		const int y1 = y0 + Chunk::SectionHeight;
+		if (y1 <= lowest_dirt)
+		{
+			c.fillSection(s, Voxel{ 1 });
+			continue;
+		}
+		if (y0 > highest_top)
+		{
+			c.fillSection(s, Voxel{ 0 });
+			continue;
+		}
+		for (int i = 0; i < _chunk_size.x; ++i)
+		{
+			for (int j = 0; j < _chunk_size.z; ++j)
 			{
-				idx.y = k;
-				c(idx) = Voxel{ 2 };
+				const ColumnInfo clm = columns[i * _chunk_size.z + j];
+				const int top = clm.dirt_start + clm.dirt_height;
+				const auto run = [&](int begin, int end, Voxel v)
+				{
+					for (int y = std::max(begin, y0); y < std::min(end, y1); ++y)
+						values[c.localId(i, y - y0, j)] = v;
+				};
+				run(y0, clm.dirt_start, Voxel{ 1 });
+				run(clm.dirt_start, top, Voxel{ 2 });
+				run(top, top + 1, Voxel{ 3 });
+				run(top + 1, y1, Voxel{ 0 });
 			}
-
-			idx.y = clm.dirt_start + clm.dirt_height;
-			c(idx) = Voxel{ 3 };
 		}
+		c.assignSection(s, values.data());
 	}
 }
 
@@ -277,162 +307,1527 @@ glm::ivec2 World::getChunkId(glm::vec3 wpos)const
 	return res;
 }
 
-void World::update(glm::vec3 cam_pos)
+float World::loadPriority(glm::ivec2 cid, glm::vec3 cam_pos, glm::vec3 cam_dir)const
 {
-	glm::ivec2 cam_chunk_id = getChunkId(cam_pos);
+	const glm::vec2 center = { (cid.x + 0.5f) * _chunk_size.x, (cid.y + 0.5f) * _chunk_size.z };
+	const glm::vec2 to_chunk = center - glm::vec2(cam_pos.x, cam_pos.z);
+	const float distance = glm::length(to_chunk) / float(_chunk_size.x);
+	const glm::vec2 view = { cam_dir.x, cam_dir.z };
+	const float view_length = glm::length(view);
+	if (view_length == 0 || distance == 0)
+		return distance;
+	// x1 in front of the camera, x2 behind it
+	const float cos_angle = glm::dot(to_chunk, view) / (glm::length(to_chunk) * view_length);
+	return distance * (1.5f - 0.5f * cos_angle);
+}
 
-	for (int i = -_load_radius; i <= _load_radius; ++i)
-	{
-		for (int j = -_load_radius; j <= _load_radius; ++j)
+void World::requestChunk(glm::ivec2 cid)
+{
+	_pending_chunks.insert(cid);
+	_jobs->submit([this, cid]()
 		{
-			glm::ivec2 cid = cam_chunk_id + glm::ivec2{ i, j };
-			if (_chunks.find(cid) == _chunks.end())
+			GeneratedChunk res{ cid, acquireChunk() };
+			const auto t_load = std::chrono::steady_clock::now();
+			res.from_disk = _regions && _regions->load(cid, res.chunk);
+			const auto t_loaded = std::chrono::steady_clock::now();
+			const uint64_t load_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t_loaded - t_load).count();
+			if (res.from_disk)
+			{
+				_disk_load_ns += load_ns;
+				++_disk_loads;
+			}
+			else
 			{
-				std::cout << "Adding a new Chunk " << cid << std::endl;
-				_chunks.insert(std::pair<glm::ivec2, Chunk>(cid, Chunk(_chunk_size)));
-				fillChunk(cid);
-				Chunk& chunk = _chunks[cid];
-				chunk.createSSBO();
-				chunk.updateSSBO();
+				fillChunk(res.chunk, cid);
+				_generation_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_loaded).count();
+				++_generations;
 			}
+
+			_lod_builder.build(res.chunk, res.lods);
+			res.connectivity.build(res.chunk, _opaque);
+			res.heights = ChunkHeights::compute(res.chunk, _opaque);
+
+			// Meshed once in the world, with the neighbours known
+			_generated_chunks.push(std::move(res));
 		}
-	}
+	);
 }
 
-bool World::chunkIsVisible(lib::Camera<float> const& cam, ChunkToDraw const& chunk)const
+void World::insertChunk(GeneratedChunk&& generated)
 {
-	return true;
+	_pending_chunks.erase(generated.id);
+	auto [handle, inserted] = _chunks.insert(generated.id, LoadedChunk{ std::move(generated.chunk), ChunkMesh(), ChunkFaces(), _frame, generated.from_disk, false });
+	LoadedChunk& loaded = _chunks[handle];
+	loaded.apron = ChunkApron(_chunk_size);
+	loaded.lods = std::move(generated.lods);
+	loaded.connectivity = std::move(generated.connectivity);
+	loaded.heights = generated.heights;
+	for (ChunkFaces& lod : loaded.lods)
+		lod.upload(_face_arena);
+	markSeamsDirty(handle);
+	// The new chunk shades the margins of all its neighbours
+	markNeighboursDirty(handle, { 0, 0 }, { _chunk_size.x - 1, _chunk_size.z - 1 });
+	++_total_generated_chunks;
 }
 
-void World::buildDrawList(lib::Camera<float> const& cam)
+bool World::UploadBudget::available()const
 {
-	_draw_list.resize(0);
-	
-	const glm::ivec2 cam_gid = getChunkId(cam.getPosition());
+	// At least one upload per frame, so that the streaming always progresses
+	if (bytes == 0)
+		return true;
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return bytes < max_bytes && ms < max_ms;
+}
 
-	bool raster = false;
+void World::update(glm::vec3 cam_pos, glm::vec3 cam_dir)
+{
+	glm::ivec2 cam_chunk_id = getChunkId(cam_pos);
+	++_frame;
 
-	if (raster)
+	// Missing chunks in the load radius, best priority first
+	_load_queue.clear();
+	for (int i = -_load_radius; i <= _load_radius; ++i)
 	{
-		const glm::vec2 cam2d_pos = { cam.getPosition().x, cam.getPosition().z };
-		const glm::vec3 cam_dir_3d = cam.getDirection();
-		const float fov = glm::radians(cam.fov());
-		
-		const glm::vec2 center_dir = glm::normalize(glm::vec2(cam_dir_3d.x, cam_dir_3d.z));
-		const glm::vec2 left_dir = lib::rotate2D(fov / 2.0f) * center_dir;
-		const glm::vec2 right_dir = lib::rotate2D(-fov / 2.0f) * center_dir;
-		
-		const glm::vec2 chunk_size = { _chunk_size.x, _chunk_size.z };
-
-		GridRayMarcher center_grm(cam2d_pos / chunk_size, center_dir);
-		GridRayMarcher left_grm(cam2d_pos / chunk_size, left_dir, center_grm._vertical);
-		GridRayMarcher right_grm(cam2d_pos / chunk_size, right_dir, center_grm._vertical);
-
-		left_grm.firstStep();
-		right_grm.firstStep();
-
-		const auto addDrawLine = [&](const glm::ivec2& left, const glm::ivec2& right, bool vertical)
+		for (int j = -_load_radius; j <= _load_radius; ++j)
 		{
-			const glm::ivec2 diff = right - left;
-			int v = vertical ? 1 : 0;
-			std::cout << diff[1 - v] << std::endl;
-			int N = abs(diff[v]) + 1;
-			std::cout << N << std::endl;
-			int B = std::min(left[v], right[v]);
-			for (int i = B; i < B + N; ++i)
+			glm::ivec2 cid = cam_chunk_id + glm::ivec2{ i, j };
+			const ChunkHandle handle = _chunks.find(cid);
+			if (handle.valid())
 			{
-				glm::ivec2 cid;
-				cid[1 - v] = left[1 - v];
-				cid[v] = i;
-				if (_chunks.contains(cid))
-				{
-					ChunkToDraw c;
-					c.chunk = &_chunks[cid];
-					c.id = cid;
-					_draw_list.push_back(c);
-				}
+				_chunks[handle].last_used = _frame;
+			}
+			else if (!_pending_chunks.contains(cid) && !_saving_chunks.contains(cid))
+			{
+				_load_queue.push_back({ loadPriority(cid, cam_pos, cam_dir), cid });
 			}
-		};
+		}
+	}
+	const auto lower_first = [](LoadRequest const& a, LoadRequest const& b)
+	{
+		return a.priority > b.priority;
+	};
+	std::make_heap(_load_queue.begin(), _load_queue.end(), lower_first);
+	// The workers only get a few chunks at once, so that the order follows the camera
+	const size_t max_generating = _streaming_budget.max_generating ? _streaming_budget.max_generating : 2 * size_t(_jobs->workerCount());
+	while (!_load_queue.empty() && _pending_chunks.size() - _ready_chunks.size() < max_generating)
+	{
+		std::pop_heap(_load_queue.begin(), _load_queue.end(), lower_first);
+		requestChunk(_load_queue.back().cid);
+		_load_queue.pop_back();
+	}
 
+	_saved_chunks.consumeAll([&](glm::ivec2&& cid)
 		{
-			addDrawLine(left_grm.getId(), right_grm.getId(), center_grm._vertical);
+			_saving_chunks.erase(cid);
 		}
+	);
 
-		while (false)
+	// Only the GL upload is left to the context thread, within the budget of the frame
+	UploadBudget budget{ std::chrono::steady_clock::now(), _streaming_budget.upload_ms, _streaming_budget.upload_bytes, 0 };
+	_generated_chunks.consumeAll([&](GeneratedChunk&& generated)
 		{
-			center_grm.stepOne();
-			glm::ivec2 draw_id = center_grm.getId();
-			if (_chunks.contains(draw_id))
-			{
-				ChunkToDraw c;
-				c.chunk = &_chunks[draw_id];
-				c.id = draw_id;
-				_draw_list.push_back(c);
-			}
-			break;
+			_ready_chunks.push_back(std::move(generated));
+		}
+	);
+	_remeshed_chunks.consumeAll([&](MeshedChunk&& meshed)
+		{
+			_ready_meshes.push_back(std::move(meshed));
 		}
+	);
+
+	const int unload_radius = _load_radius + _unload_margin;
+	while (!_ready_chunks.empty() && budget.available())
+	{
+		GeneratedChunk& generated = _ready_chunks.front();
+		if (distanceTchebychev(generated.id, cam_chunk_id) > unload_radius)
+		{
+			// Out of range since it was requested
+			_pending_chunks.erase(generated.id);
+			releaseChunk(std::move(generated.chunk));
+		}
+		else
+		{
+			for (ChunkFaces const& lod : generated.lods)
+				budget.bytes += lod.byteSize();
+			insertChunk(std::move(generated));
+		}
+		_ready_chunks.pop_front();
 	}
-	else
+
+	while (!_ready_meshes.empty() && budget.available())
 	{
-		for (auto& [k, chunk] : _chunks)
+		MeshedChunk& meshed = _ready_meshes.front();
+		// Not unloaded while meshing
+		LoadedChunk& loaded = _chunks[meshed.handle];
+		loaded.meshing = false;
+		if (meshed.full_res)
 		{
-			// TODO only keep chunks that intersect the frustum
-			if (distanceTchebychev(k, cam_gid) <= _draw_distance)
+			loaded.mesh = std::move(meshed.mesh);
+			loaded.faces = std::move(meshed.faces);
+			loaded.seam_faces = meshed.seam_faces;
+			loaded.has_full_res = true;
+			loaded.light = std::move(meshed.light);
+			loaded.light_batch = meshed.light_batch;
+			loaded.lighting_batch = 0;
+		}
+		if (meshed.has_lods)
+		{
+			loaded.lods = std::move(meshed.lods);
+			for (ChunkFaces& lod : loaded.lods)
 			{
-				ChunkToDraw td;
-				td.chunk = &chunk;
-				td.id = k;
+				lod.upload(_face_arena);
+				budget.bytes += lod.byteSize();
+			}
+		}
+		if (meshed.full_res && loaded.resident)
+		{
+			loaded.mesh.upload(&_buffer_pool);
+			loaded.faces.upload(_face_arena);
+			budget.bytes += loaded.mesh.byteSize() + loaded.faces.byteSize();
+		}
+		_ready_meshes.pop_front();
+	}
 
-				glm::vec2 chunk_center = { (k.x + 0.5) * _chunk_size.x, (k.y + 0.5) * _chunk_size.z };
-				glm::vec2 cam_pos = { cam.getPosition().x, cam.getPosition().z };
+	evictChunks(cam_chunk_id);
 
-				td.distance = glm::distance(cam_pos, chunk_center);
+	applyEdits();
 
-				_draw_list.push_back(td);
-			}
+	const auto seams_start = std::chrono::steady_clock::now();
+	updateSeams(cam_chunk_id);
+	_streaming_stats.seams_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seams_start).count();
+
+	updateResidency(cam_chunk_id, budget);
+
+	_chunks.forEach([&](ChunkHandle, glm::ivec2, LoadedChunk& loaded)
+		{
+			if (loaded.resident && loaded.chunk.dirty())
+				budget.bytes += loaded.chunk.updateSSBO();
 		}
+	);
 
-		std::sort(_draw_list.begin(), _draw_list.end(), [](ChunkToDraw const& a, ChunkToDraw const& b)
-			{
-				return a.distance < b.distance;
-			}
-		);
-	}
+	_streaming_stats.load_queue = _load_queue.size();
+	_streaming_stats.generating = _pending_chunks.size() - _ready_chunks.size();
+	_streaming_stats.waiting_upload = _ready_chunks.size() + _ready_meshes.size();
+	_streaming_stats.uploaded_bytes = budget.bytes;
+	_streaming_stats.upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - budget.start).count();
 }
 
-void World::draw(lib::Camera<float> const& cam)
+void World::setStreamingBudget(StreamingBudget const& budget)
 {
-	glBindVertexArray(a_ids_vao);
+	_streaming_budget = budget;
+}
 
-	glm::ivec2 cam_cid = getChunkId(cam.getPosition());
-	glm::mat4 V = cam.getMatrixV();
-	glm::vec3 recenter_v = { cam_cid.x * _chunk_size.x, 0, cam_cid.y * _chunk_size.z};
-	glm::mat4 recenter_m = lib::translateMatrix<4, float>(-recenter_v);
-	V = V * recenter_m;
-	std::cout << V[3] << std::endl;
-	glm::vec3 recentered_cam_pos = cam.getPosition() - recenter_v;
+World::StreamingBudget const& World::streamingBudget()const
+{
+	return _streaming_budget;
+}
 
-	_vox_prog->use();
-	_vox_prog->setUniform("u_V", V);
-	_vox_prog->setUniform("u_P", cam.getMatrixP());
-	_vox_prog->setUniform("u_cam_pos", recentered_cam_pos);
+World::StreamingStats const& World::streamingStats()const
+{
+	return _streaming_stats;
+}
 
-	for(ChunkToDraw & td : _draw_list)
+RayHit World::raycast(Ray const& ray)const
+{
+	RayHit res;
+	raycast(&ray, 1, &res);
+	return res;
+}
+
+void World::raycast(Ray const* rays, size_t n, RayHit* hits)const
+{
+	const auto lookup = [this](glm::ivec2 cid) -> Chunk const*
 	{
-		const glm::ivec2 recentered_cid = ( td.id);
-		glm::vec3 chunk_base = { recentered_cid.x * _chunk_size.x, 0, recentered_cid.y * _chunk_size.z };
-		glm::mat4 M = lib::translateMatrix<4, float>(chunk_base);
+		const LoadedChunk* loaded = _chunks.get(cid);
+		return loaded ? &loaded->chunk : nullptr;
+	};
+	VoxelRaycaster<decltype(lookup)> raycaster(_chunk_size, lookup);
+	raycaster.cast(rays, n, hits);
+}
 
-		_vox_prog->setUniform("u_M", M);
-		_vox_prog->setUniform("grid_strides", td.chunk->strides());
-		_vox_prog->setUniform("grid_dims", td.chunk->dims());
+size_t World::loadedChunks()const
+{
+	return _chunks.size();
+}
 
-		td.chunk->bind();
+size_t World::fullResChunks()const
+{
+	size_t res = 0;
+	_chunks.forEach([&](ChunkHandle, glm::ivec2, LoadedChunk const& loaded)
+		{
+			res += loaded.has_full_res ? 1 : 0;
+		}
+	);
+	return res;
+}
 
-		glDrawArrays(GL_POINTS, 0, td.chunk->size());
-	}
+size_t World::pendingChunks()const
+{
+	return _pending_chunks.size();
+}
 
-	lib::ProgramDesc::useNone();
-	glBindVertexArray(0);
+size_t World::totalGeneratedChunks()const
+{
+	return _total_generated_chunks;
+}
+
+size_t World::totalUnloadedChunks()const
+{
+	return _total_unloaded_chunks;
+}
+
+double World::meanDiskLoadMs()const
+{
+	const size_t n = _disk_loads;
+	return n ? (double(_disk_load_ns) * 1e-6 / double(n)) : 0.0;
+}
+
+double World::meanGenerationMs()const
+{
+	const size_t n = _generations;
+	return n ? (double(_generation_ns) * 1e-6 / double(n)) : 0.0;
+}
+
+size_t World::totalDiskLoads()const
+{
+	return _disk_loads;
+}
+
+size_t World::hostMemory(LoadedChunk const& loaded)
+{
+	size_t res = loaded.chunk.memoryUsage() + loaded.mesh.byteSize() + loaded.faces.byteSize() + loaded.apron.byteSize();
+	for (ChunkFaces const& lod : loaded.lods)
+		res += lod.byteSize();
+	if (loaded.light)
+		res += loaded.light->byteSize();
+	return res;
+}
+
+size_t World::deviceMemory(LoadedChunk const& loaded)
+{
+	size_t res = loaded.chunk.deviceMemoryUsage() + loaded.mesh.deviceMemoryUsage() + loaded.faces.deviceMemoryUsage() + loaded.apron.deviceMemoryUsage();
+	for (ChunkFaces const& lod : loaded.lods)
+		res += lod.deviceMemoryUsage();
+	return res;
+}
+
+size_t World::chunksHostMemory()const
+{
+	size_t res = 0;
+	_chunks.forEach([&](ChunkHandle, glm::ivec2, LoadedChunk const& loaded)
+		{
+			res += hostMemory(loaded);
+		}
+	);
+	return res;
+}
 
-}
\ No newline at end of file
+size_t World::chunksDeviceMemory()const
+{
+	size_t res = 0;
+	_chunks.forEach([&](ChunkHandle, glm::ivec2, LoadedChunk const& loaded)
+		{
+			res += deviceMemory(loaded);
+		}
+	);
+	return res;
+}
+
+void World::setMemoryBudget(size_t bytes)
+{
+	_memory_budget = bytes;
+}
+
+size_t World::memoryBudget()const
+{
+	return _memory_budget;
+}
+
+BufferPool const& World::bufferPool()const
+{
+	return _buffer_pool;
+}
+
+BufferArena const& World::faceArena()const
+{
+	return _face_arena;
+}
+
+BufferArena const& World::voxelArena()const
+{
+	return _voxel_arena;
+}
+
+Chunk World::acquireChunk()
+{
+	{
+		std::unique_lock lock(_chunk_pool_mutex);
+		if (!_chunk_pool.empty())
+		{
+			Chunk res = std::move(_chunk_pool.back());
+			_chunk_pool.pop_back();
+			return res;
+		}
+	}
+	return Chunk(_chunk_size);
+}
+
+void World::releaseChunk(Chunk&& chunk)
+{
+	chunk.deleteSSBO();
+	std::unique_lock lock(_chunk_pool_mutex);
+	if (_chunk_pool.size() < MaxPooledChunks)
+		_chunk_pool.push_back(std::move(chunk));
+}
+
+void World::queueSeams(ChunkHandle handle)
+{
+	LoadedChunk& loaded = _chunks[handle];
+	if (!loaded.seams_queued)
+	{
+		loaded.seams_queued = true;
+		_seam_dirty_chunks.push_back(handle);
+	}
+}
+
+void World::markSeamsDirty(ChunkHandle handle, std::span<const glm::ivec3> light_seeds)
+{
+	LoadedChunk& loaded = _chunks[handle];
+	loaded.seams_dirty = true;
+	if (!light_seeds.empty() && !loaded.seeds_batch)
+		loaded.seeds_batch = _edit_batch;
+	// Not needed to build the light from scratch
+	if (!light_seeds.empty() && loaded.light && !loaded.full_light)
+		loaded.light_seeds.insert(loaded.light_seeds.end(), light_seeds.begin(), light_seeds.end());
+	else
+		loaded.full_light = true;
+	queueSeams(handle);
+}
+
+size_t World::markNeighboursDirty(ChunkHandle handle, glm::ivec2 const& lo, glm::ivec2 const& hi, std::span<const glm::ivec3> light_seeds)
+{
+	constexpr int M = LightMargin::Margin;
+	const glm::ivec2 cid = _chunks.id(handle);
+	const glm::ivec2 size = { _chunk_size.x, _chunk_size.z };
+	size_t res = 0;
+	for (int dx = -1; dx <= 1; ++dx)
+	{
+		for (int dz = -1; dz <= 1; ++dz)
+		{
+			const glm::ivec2 d = { dx, dz };
+			bool seen = d != glm::ivec2(0);
+			for (int i = 0; i < 2; ++i)
+				seen &= d[i] < 0 ? lo[i] < M : (d[i] > 0 ? hi[i] >= size[i] - M : true);
+			if (!seen)
+				continue;
+			const ChunkHandle neighbour = _chunks.find(cid + d);
+			if (neighbour.valid())
+			{
+				markSeamsDirty(neighbour, light_seeds);
+				++res;
+			}
+		}
+	}
+	return res;
+}
+
+bool World::canUpdateLight(ChunkHandle handle)const
+{
+	LoadedChunk const& loaded = _chunks[handle];
+	if (!loaded.light || loaded.full_light || loaded.light_seeds.empty())
+		return false;
+	// First edit batch not taken into account by the light of the chunk
+	const auto firstUnlit = [](LoadedChunk const& chunk)
+	{
+		return std::min(chunk.seeds_batch ? chunk.seeds_batch : UINT64_MAX, chunk.lighting_batch ? chunk.lighting_batch : UINT64_MAX);
+	};
+	const glm::ivec2 cid = _chunks.id(handle);
+	for (int dx = -1; dx <= 1; ++dx)
+	{
+		for (int dz = -1; dz <= 1; ++dz)
+		{
+			if (!dx && !dz)
+				continue;
+			const LoadedChunk* neighbour = _chunks.get(cid + glm::ivec2(dx, dz));
+			if (!neighbour || !neighbour->light)
+				return false;
+			// An older neighbour must not miss edits the chunk has, a newer one must not have the ones the chunk misses
+			if (neighbour->light_batch <= loaded.light_batch ? firstUnlit(*neighbour) <= loaded.light_batch : loaded.seeds_batch <= neighbour->light_batch)
+				return false;
+		}
+	}
+	return true;
+}
+
+int World::meshRadius()const
+{
+	return _lod_distances[0] + 2;
+}
+
+void World::updateSeams(glm::ivec2 cam_cid)
+{
+	const int mesh_radius = meshRadius();
+	size_t kept = 0;
+	for (ChunkHandle handle : _seam_dirty_chunks)
+	{
+		if (!_chunks.isValid(handle))
+			continue;
+		LoadedChunk& loaded = _chunks[handle];
+		if (loaded.meshing)
+		{
+			// The worker reads the apron, rebuilt after it is done
+			_seam_dirty_chunks[kept++] = handle;
+			continue;
+		}
+		loaded.seams_queued = false;
+		// Beyond the full resolution distance, the chunk stays dirty until updateResidency queues it again
+		const bool full_res = _mesh_all || distanceTchebychev(_chunks.id(handle), cam_cid) <= mesh_radius;
+		if (!full_res && !loaded.lods_dirty)
+			continue;
+		loaded.meshing = true;
+		const bool rebuild_lods = loaded.lods_dirty;
+		loaded.lods_dirty = false;
+
+		std::shared_ptr<LightMargin> margin;
+		// From the light of the chunk and of its neighbours, if it can be updated from the edited cells
+		std::shared_ptr<const ChunkLight> previous_light;
+		std::vector<glm::ivec3> light_seeds;
+		const uint64_t light_batch = _edit_batch;
+		bool edit_lighting = false;
+		if (full_res)
+		{
+			for (int n = 0; n < ChunkMap<LoadedChunk>::NeighbourCount; ++n)
+			{
+				const ChunkHandle neighbour = _chunks.neighbour(handle, n);
+				if (neighbour.valid())
+					loaded.apron.setSide(n, _chunks[neighbour].chunk, _opaque);
+				else
+					loaded.apron.clearSide(n);
+			}
+			if (loaded.resident)
+				loaded.apron.upload(_voxel_arena);
+			loaded.seams_dirty = false;
+
+			// The neighbours can change while the worker lights the chunk: their columns within the margin are copied,
+			// their light is shared (replaced, never modified)
+			const glm::ivec2 cid = _chunks.id(handle);
+			const bool update_light = canUpdateLight(handle);
+			margin = std::make_shared<LightMargin>(_chunk_size);
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				for (int dz = -1; dz <= 1; ++dz)
+				{
+					const LoadedChunk* neighbour = (dx || dz) ? _chunks.get(cid + glm::ivec2(dx, dz)) : nullptr;
+					if (neighbour)
+					{
+						margin->setNeighbour({ dx, dz }, neighbour->chunk, _opaque, _emission);
+						if (update_light)
+							margin->setNeighbourLight({ dx, dz }, neighbour->light);
+					}
+				}
+			}
+			if (update_light)
+			{
+				previous_light = loaded.light;
+				const glm::ivec3 origin = { cid.x * _chunk_size.x, 0, cid.y * _chunk_size.z };
+				light_seeds.reserve(loaded.light_seeds.size());
+				for (glm::ivec3 const& seed : loaded.light_seeds)
+					light_seeds.push_back(seed - origin);
+			}
+			edit_lighting = loaded.seeds_batch != 0;
+			loaded.lighting_batch = loaded.seeds_batch;
+			loaded.seeds_batch = 0;
+			loaded.light_seeds.clear();
+			loaded.full_light = false;
+		}
+
+		// The slots do not move and the chunk is not unloaded (nor edited) until the result is consumed
+		const Chunk* chunk = &loaded.chunk;
+		const ChunkApron* apron = &loaded.apron;
+		_jobs->submit([this, handle, chunk, apron, rebuild_lods, full_res, margin, previous_light, light_seeds = std::move(light_seeds), light_batch, edit_lighting]()
+			{
+				MeshedChunk res{ handle };
+				res.full_res = full_res;
+				if (rebuild_lods)
+				{
+					_lod_builder.build(*chunk, res.lods);
+					res.has_lods = true;
+				}
+				if (full_res)
+				{
+					const auto t0 = std::chrono::steady_clock::now();
+					_mesher.mesh(*chunk, res.mesh, apron);
+					const auto t1 = std::chrono::steady_clock::now();
+					_meshing_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+					++_meshed_chunks;
+
+					// Bounded by the cells of the chunk and its margin up to the highest opaque one, or by the cells
+					// around the edited ones
+					thread_local LightVolume light;
+					if (previous_light)
+						_light_builder.update(*chunk, *margin, *previous_light, light_seeds, light);
+					else
+						_light_builder.build(*chunk, *margin, light);
+					std::shared_ptr<ChunkLight> kept = std::make_shared<ChunkLight>();
+					light.copyChunk(*kept);
+					res.light = std::move(kept);
+					res.light_batch = light_batch;
+					const auto t2 = std::chrono::steady_clock::now();
+					const uint64_t lighting_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+					_lighting_ns += lighting_ns;
+					if (edit_lighting)
+					{
+						_edit_lighting_ns += lighting_ns;
+						++_edit_lit_chunks;
+						if (previous_light)
+							++_incremental_lit_chunks;
+					}
+
+					res.seam_faces = _face_builder.build(*chunk, res.faces, apron, &light);
+					_face_building_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t2).count();
+				}
+				_remeshed_chunks.push(std::move(res));
+			}
+		);
+	}
+	_seam_dirty_chunks.resize(kept);
+}
+
+void World::setBlock(glm::ivec3 const& position, Voxel value)
+{
+	_block_edits.push_back({ position, value });
+}
+
+void World::setBlocks(std::span<const BlockEdit> edits)
+{
+	_block_edits.insert(_block_edits.end(), edits.begin(), edits.end());
+}
+
+World::EditStats const& World::editStats()const
+{
+	return _edit_stats;
+}
+
+void World::applyEdits()
+{
+	const auto start = std::chrono::steady_clock::now();
+	_edit_stats = {};
+	if (_block_edits.empty())
+		return;
+	++_edit_batch;
+
+	const auto floorDiv = [](int a, int b)
+	{
+		return (a >= 0 ? a : a - b + 1) / b;
+	};
+	const auto chunkOf = [&](BlockEdit const& edit)
+	{
+		return glm::ivec2(floorDiv(edit.position.x, _chunk_size.x), floorDiv(edit.position.z, _chunk_size.z));
+	};
+	// Grouped by chunk, in the order they were made within a chunk
+	std::stable_sort(_block_edits.begin(), _block_edits.end(), [&](BlockEdit const& a, BlockEdit const& b)
+		{
+			const glm::ivec2 ca = chunkOf(a), cb = chunkOf(b);
+			return ca.x != cb.x ? ca.x < cb.x : ca.y < cb.y;
+		}
+	);
+
+	size_t kept = 0;
+	for (size_t begin = 0; begin < _block_edits.size();)
+	{
+		const glm::ivec2 cid = chunkOf(_block_edits[begin]);
+		size_t end = begin + 1;
+		while (end < _block_edits.size() && chunkOf(_block_edits[end]) == cid)
+			++end;
+
+		const ChunkHandle handle = _chunks.find(cid);
+		if (!handle.valid())
+		{
+			_edit_stats.dropped += end - begin;
+			begin = end;
+			continue;
+		}
+		LoadedChunk& loaded = _chunks[handle];
+		if (loaded.meshing)
+		{
+			// A worker reads the chunk
+			for (size_t i = begin; i < end; ++i)
+				_block_edits[kept++] = _block_edits[i];
+			_edit_stats.deferred += end - begin;
+			begin = end;
+			continue;
+		}
+
+		const glm::ivec3 origin = { cid.x * _chunk_size.x, 0, cid.y * _chunk_size.z };
+		// bit s: section s changed, [lo, hi]: columns changed
+		uint32_t sections = 0;
+		glm::ivec2 lo = { _chunk_size.x, _chunk_size.z }, hi = { -1, -1 };
+		// The cells changed, their light is updated from them
+		thread_local std::vector<glm::ivec3> changed;
+		changed.clear();
+		for (size_t i = begin; i < end; ++i)
+		{
+			const glm::ivec3 p = _block_edits[i].position - origin;
+			if (p.y < 0 || p.y >= _chunk_size.y)
+			{
+				++_edit_stats.dropped;
+				continue;
+			}
+			++_edit_stats.applied;
+			const Voxel value = _block_edits[i].value;
+			if (Voxel(loaded.chunk(p)) == value)
+				continue;
+			loaded.chunk(p) = value;
+			changed.push_back(_block_edits[i].position);
+			sections |= 1u << (p.y / Chunk::SectionHeight);
+			lo = glm::min(lo, glm::ivec2(p.x, p.z));
+			hi = glm::max(hi, glm::ivec2(p.x, p.z));
+		}
+		begin = end;
+		if (sections == 0)
+			continue;
+
+		for (int s = 0; s < loaded.chunk.sectionCount(); ++s)
+		{
+			if (sections & (1u << s))
+			{
+				loaded.connectivity.buildSection(loaded.chunk, s, _opaque);
+				++_edit_stats.sections;
+			}
+		}
+		loaded.heights = ChunkHeights::compute(loaded.chunk, _opaque);
+		loaded.modified = true;
+		loaded.lods_dirty = true;
+		markSeamsDirty(handle, changed);
+		_edit_stats.neighbours += markNeighboursDirty(handle, lo, hi, changed);
+		++_edit_stats.chunks;
+	}
+	_block_edits.resize(kept);
+	_edit_stats.apply_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void World::updateResidency(glm::ivec2 cam_cid, UploadBudget& budget)
+{
+	const int radius = _lod_distances[0] + 1;
+	const int mesh_radius = meshRadius();
+	_chunks.forEach([&](ChunkHandle handle, glm::ivec2 cid, LoadedChunk& loaded)
+		{
+			const int d = distanceTchebychev(cid, cam_cid);
+			if (d <= mesh_radius && loaded.seams_dirty && !loaded.seams_queued)
+			{
+				// Left dirty by updateSeams while it was further away
+				queueSeams(handle);
+			}
+			else if (!_mesh_all && d > mesh_radius + 1 && loaded.has_full_res && !loaded.meshing)
+			{
+				// Not resident, the full resolution is built again if the camera comes back
+				loaded.mesh = ChunkMesh();
+				loaded.faces = ChunkFaces();
+				loaded.seam_faces = 0;
+				loaded.has_full_res = false;
+				loaded.seams_dirty = true;
+				loaded.light.reset();
+				loaded.light_seeds.clear();
+				loaded.full_light = true;
+			}
+
+			const bool in_range = d <= radius;
+			if (in_range && !loaded.resident)
+			{
+				// Drawn with the first LOD level until then, and until its full resolution mesh is built
+				if (!budget.available() || !loaded.has_full_res)
+					return;
+				loaded.chunk.createSSBO(_voxel_arena, true);
+				loaded.mesh.upload(&_buffer_pool);
+				loaded.faces.upload(_face_arena);
+				loaded.apron.upload(_voxel_arena);
+				loaded.resident = true;
+				budget.bytes += loaded.chunk.byteSize() + loaded.mesh.byteSize() + loaded.faces.byteSize() + loaded.apron.byteSize();
+			}
+			else if (!in_range && loaded.resident)
+			{
+				loaded.chunk.deleteSSBO();
+				loaded.mesh.deleteBuffer();
+				loaded.faces.deleteBuffer();
+				loaded.apron.deleteBuffer();
+				loaded.resident = false;
+			}
+		}
+	);
+}
+
+size_t World::seamFacesRemoved()const
+{
+	size_t res = 0;
+	_chunks.forEach([&](ChunkHandle, glm::ivec2, LoadedChunk const& loaded)
+		{
+			res += loaded.seam_faces;
+		}
+	);
+	return res;
+}
+
+void World::unloadChunk(ChunkHandle handle)
+{
+	LoadedChunk& loaded = _chunks[handle];
+	assert(!loaded.meshing);
+	for (int n = 0; n < ChunkMap<LoadedChunk>::NeighbourCount; ++n)
+	{
+		const ChunkHandle neighbour = _chunks.neighbour(handle, n);
+		if (neighbour.valid())
+			markSeamsDirty(neighbour);
+	}
+	loaded.mesh.deleteBuffer();
+	loaded.faces.deleteBuffer();
+	loaded.apron.deleteBuffer();
+	for (ChunkFaces& lod : loaded.lods)
+		lod.deleteBuffer();
+	if (_regions && (loaded.modified || !loaded.on_disk))
+	{
+		// Written (and then given back to the pool) by the save thread
+		const glm::ivec2 cid = _chunks.id(handle);
+		loaded.chunk.deleteSSBO();
+		std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(std::move(loaded.chunk));
+		_saving_chunks.insert(cid);
+		_save_jobs->submit([this, cid, chunk]()
+			{
+				_regions->save(cid, *chunk);
+				releaseChunk(std::move(*chunk));
+				_saved_chunks.push(glm::ivec2(cid));
+			}
+		);
+	}
+	else
+	{
+		releaseChunk(std::move(loaded.chunk));
+	}
+	_chunks.erase(handle);
+	++_total_unloaded_chunks;
+}
+
+void World::evictChunks(glm::ivec2 cam_cid)
+{
+	const int unload_radius = _load_radius + _unload_margin;
+	size_t memory = 0;
+	_eviction_candidates.clear();
+	_chunks.forEach([&](ChunkHandle handle, glm::ivec2 cid, LoadedChunk const& loaded)
+		{
+			const int d = distanceTchebychev(cid, cam_cid);
+			if (loaded.meshing)
+			{
+				// Evicted once the worker is done with it
+				memory += hostMemory(loaded) + deviceMemory(loaded);
+			}
+			else if (d > unload_radius)
+			{
+				// Always unloaded: 0 sorts them first (the frames start at 1)
+				// The handles stay valid, erasing does not move the other slots
+				_eviction_candidates.push_back({ 0, handle });
+			}
+			else
+			{
+				memory += hostMemory(loaded) + deviceMemory(loaded);
+				if (d > _load_radius)
+					_eviction_candidates.push_back({ loaded.last_used, handle });
+			}
+		}
+	);
+
+	std::sort(_eviction_candidates.begin(), _eviction_candidates.end(), [](auto const& a, auto const& b)
+		{
+			return a.first < b.first;
+		}
+	);
+	for (auto const& [last_used, handle] : _eviction_candidates)
+	{
+		if (last_used != 0)
+		{
+			if (memory <= _memory_budget)
+				break;
+			memory -= hostMemory(_chunks[handle]) + deviceMemory(_chunks[handle]);
+		}
+		unloadChunk(handle);
+	}
+}
+
+void World::setViewDistance(int chunks)
+{
+	_load_radius = chunks;
+	_draw_distance = chunks;
+}
+
+int World::viewDistance()const
+{
+	return _draw_distance;
+}
+
+void World::setLodDistances(std::array<int, LodBuilder::Levels> const& distances)
+{
+	_lod_distances = distances;
+}
+
+int World::lodLevel(int chunk_distance)const
+{
+	for (int l = 0; l < LodBuilder::Levels; ++l)
+	{
+		if (chunk_distance <= _lod_distances[l])
+			return l;
+	}
+	return LodBuilder::Levels;
+}
+
+void World::setRenderer(Renderer renderer)
+{
+	_renderer = renderer;
+}
+
+World::Renderer World::renderer()const
+{
+	return _renderer;
+}
+
+World::RenderStats const& World::renderStats()const
+{
+	return _render_stats;
+}
+
+void World::setMultiDraw(bool enable)
+{
+	_multi_draw = enable;
+}
+
+bool World::multiDraw()const
+{
+	return _multi_draw;
+}
+
+void World::setMeshAllChunks(bool enable)
+{
+	_mesh_all = enable;
+	if (enable)
+	{
+		_chunks.forEach([&](ChunkHandle handle, glm::ivec2, LoadedChunk& loaded)
+			{
+				if (loaded.seams_dirty)
+					queueSeams(handle);
+			}
+		);
+	}
+}
+
+bool World::meshAllChunks()const
+{
+	return _mesh_all;
+}
+
+size_t World::totalMeshedChunks()const
+{
+	return _meshed_chunks;
+}
+
+double World::totalMeshingMs()const
+{
+	return double(_meshing_ns + _lighting_ns + _face_building_ns) * 1e-6;
+}
+
+double World::meanMeshingMs()const
+{
+	const size_t n = _meshed_chunks;
+	return n ? (double(_meshing_ns) * 1e-6 / double(n)) : 0.0;
+}
+
+double World::meanFaceBuildingMs()const
+{
+	const size_t n = _meshed_chunks;
+	return n ? (double(_face_building_ns) * 1e-6 / double(n)) : 0.0;
+}
+
+double World::meanLightingMs()const
+{
+	const size_t n = _meshed_chunks;
+	return n ? (double(_lighting_ns) * 1e-6 / double(n)) : 0.0;
+}
+
+double World::editLightingMs()const
+{
+	return double(_edit_lighting_ns) * 1e-6;
+}
+
+size_t World::editLitChunks()const
+{
+	return _edit_lit_chunks;
+}
+
+size_t World::incrementalLitChunks()const
+{
+	return _incremental_lit_chunks;
+}
+
+void World::chunkBox(glm::ivec2 cid, glm::vec3& box_min, glm::vec3& box_max)const
+{
+	box_min = { cid.x * _chunk_size.x, 0, cid.y * _chunk_size.z };
+	box_max = box_min + glm::vec3(_chunk_size);
+}
+
+bool World::sectionIsUniformOpaque(Chunk const& chunk, int s)const
+{
+	const PaletteStorage& section = chunk.section(s);
+	return section.uniform() && isOpaque(section.palette()[0]);
+}
+
+uint32_t World::sectionsToDraw(ChunkHandle handle)const
+{
+	const Chunk& chunk = _chunks[handle].chunk;
+	assert(chunk.sectionCount() <= 32);
+	const Chunk* neighbour_chunks[ChunkMap<LoadedChunk>::NeighbourCount];
+	for (int n = 0; n < ChunkMap<LoadedChunk>::NeighbourCount; ++n)
+	{
+		const ChunkHandle neighbour = _chunks.neighbour(handle, n);
+		neighbour_chunks[n] = neighbour.valid() ? &_chunks[neighbour].chunk : nullptr;
+	}
+
+	uint32_t res = 0;
+	for (int s = 0; s < chunk.sectionCount(); ++s)
+	{
+		const PaletteStorage& section = chunk.section(s);
+		if (section.uniform())
+		{
+			const Voxel v = section.palette()[0];
+			if (v.id == 0)
+				continue;
+			if (isOpaque(v))
+			{
+				// Nothing can be seen below the world
+				bool occluded = (s == 0 || sectionIsUniformOpaque(chunk, s - 1));
+				occluded = occluded && (s + 1 < chunk.sectionCount() && sectionIsUniformOpaque(chunk, s + 1));
+				for (int n = 0; n < 4 && occluded; ++n)
+					occluded = neighbour_chunks[n] && sectionIsUniformOpaque(*neighbour_chunks[n], s);
+				if (occluded)
+					continue;
+			}
+		}
+		res |= 1u << s;
+	}
+	return res;
+}
+
+bool World::chunkIsVisible(lib::Camera<float> const& cam, ChunkToDraw const& chunk)const
+{
+	glm::vec3 box_min, box_max;
+	chunkBox(chunk.id, box_min, box_max);
+	return Frustum::fromCamera(cam).intersects(box_min, box_max);
+}
+
+void World::buildDrawList(lib::Camera<float> const& cam)
+{
+	_draw_list.resize(0);
+	_cull_boxes.clear();
+	
+	const glm::ivec2 cam_gid = getChunkId(cam.getPosition());
+	const glm::vec2 cam_pos = { cam.getPosition().x, cam.getPosition().z };
+
+	_chunks.forEach([&](ChunkHandle handle, glm::ivec2 k, LoadedChunk& loaded)
+		{
+			const int d = distanceTchebychev(k, cam_gid);
+			if (d <= _draw_distance)
+			{
+				ChunkToDraw td;
+				td.chunk = &loaded.chunk;
+				td.handle = handle;
+				td.id = k;
+				// A chunk that just came in range may not have its full resolution buffers yet
+				td.lod = loaded.resident ? lodLevel(d) : std::max(1, lodLevel(d));
+
+				glm::vec2 chunk_center = { (k.x + 0.5) * _chunk_size.x, (k.y + 0.5) * _chunk_size.z };
+
+				td.distance = glm::distance(cam_pos, chunk_center);
+
+				_draw_list.push_back(td);
+
+				glm::vec3 box_min, box_max;
+				chunkBox(k, box_min, box_max);
+				_cull_boxes.push_back(box_min, box_max);
+			}
+		}
+	);
+	_cull_stats.candidates = _draw_list.size();
+
+	if (_frustum_culling)
+	{
+		cullAABBs(Frustum::fromCamera(cam), _cull_boxes, _cull_visible);
+		size_t n = 0;
+		for (size_t i = 0; i < _draw_list.size(); ++i)
+		{
+			if (_cull_visible[i])
+				_draw_list[n++] = _draw_list[i];
+		}
+		_draw_list.resize(n);
+	}
+	_cull_stats.culled = _cull_stats.candidates - _draw_list.size();
+
+	for (ChunkToDraw& td : _draw_list)
+	{
+		td.sections = td.lod == 0 ? sectionsToDraw(td.handle) : 0;
+	}
+
+	_cull_stats.cave_culled = 0;
+	if (_cave_culling && caveCull(cam))
+	{
+		size_t n = 0;
+		for (ChunkToDraw td : _draw_list)
+		{
+			const LoadedChunk& loaded = _chunks[td.handle];
+			const uint32_t reached = loaded.cave_frame == _cave_frame ? loaded.cave_sections : 0;
+			td.sections &= reached;
+			if (reached == 0 || (td.lod == 0 && td.sections == 0))
+				continue;
+			_draw_list[n++] = td;
+		}
+		_cull_stats.cave_culled = _draw_list.size() - n;
+		_draw_list.resize(n);
+	}
+
+	_cull_stats.horizon_culled = 0;
+	if (_horizon_culling && cam.getPosition().y >= 0)
+	{
+		const size_t n = _draw_list.size();
+		horizonCull(cam);
+		_cull_stats.horizon_culled = n - _draw_list.size();
+	}
+
+	std::sort(_draw_list.begin(), _draw_list.end(), [](ChunkToDraw const& a, ChunkToDraw const& b)
+		{
+			return a.distance < b.distance;
+		}
+	);
+}
+
+bool World::caveCull(lib::Camera<float> const& cam)
+{
+	const glm::vec3 cam_pos = cam.getPosition();
+	const glm::ivec2 cam_cid = getChunkId(cam_pos);
+	const ChunkHandle start = _chunks.find(cam_cid);
+	if (!start.valid() || cam_pos.y < 0 || cam_pos.y >= float(_chunk_size.y))
+		return false;
+	const int sections = _chunk_size.y / Chunk::SectionHeight;
+	const Frustum frustum = Frustum::fromCamera(cam);
+
+	++_cave_frame;
+	_cave_queue.clear();
+	const auto visit = [&](ChunkHandle handle, glm::ivec2 cid, int s, int entered, uint32_t directions)
+	{
+		LoadedChunk& loaded = _chunks[handle];
+		if (loaded.cave_frame != _cave_frame)
+		{
+			loaded.cave_frame = _cave_frame;
+			loaded.cave_sections = 0;
+		}
+		if (loaded.cave_sections & (1u << s))
+			return;
+		if (_frustum_culling && entered >= 0)
+		{
+			const glm::vec3 box_min = { cid.x * _chunk_size.x, s * Chunk::SectionHeight, cid.y * _chunk_size.z };
+			if (!frustum.intersects(box_min, box_min + glm::vec3(_chunk_size.x, Chunk::SectionHeight, _chunk_size.z)))
+				return;
+		}
+		loaded.cave_sections |= 1u << s;
+		_cave_queue.push_back({ handle, cid, s, entered, directions });
+	};
+	visit(start, cam_cid, int(cam_pos.y) / Chunk::SectionHeight, -1, 0);
+
+	for (size_t i = 0; i < _cave_queue.size(); ++i)
+	{
+		const CaveStep step = _cave_queue[i];
+		const SectionConnectivity connectivity = _chunks[step.handle].connectivity.section(step.section);
+		for (int f = 0; f < SectionConnectivity::Faces; ++f)
+		{
+			// Entered through the face f ^ 1 of the next section
+			const int back = f ^ 1;
+			if ((step.directions >> back) & 1u)
+				continue;
+			if (step.entered >= 0 && !connectivity.connected(step.entered, f))
+				continue;
+			const uint32_t directions = step.directions | (1u << f);
+			const int axis = f / 2;
+			if (axis == 1)
+			{
+				const int s = step.section + (f == 2 ? 1 : -1);
+				if (s >= 0 && s < sections)
+					visit(step.handle, step.cid, s, back, directions);
+				continue;
+			}
+			const int n = ChunkApron::side(axis, f % 2);
+			const ChunkHandle neighbour = _chunks.neighbour(step.handle, n);
+			const glm::ivec2 cid = step.cid + ChunkMap<LoadedChunk>::neighbourOffset(n);
+			if (neighbour.valid() && distanceTchebychev(cid, cam_cid) <= _draw_distance)
+				visit(neighbour, cid, step.section, back, directions);
+		}
+	}
+	return true;
+}
+
+void World::horizonCull(lib::Camera<float> const& cam)
+{
+	const glm::vec3 cam_pos = cam.getPosition();
+	const glm::ivec2 cam_cid = getChunkId(cam_pos);
+	_horizon.reset(cam_pos);
+
+	_horizon_order.resize(_draw_list.size());
+	std::iota(_horizon_order.begin(), _horizon_order.end(), 0);
+	std::sort(_horizon_order.begin(), _horizon_order.end(), [&](uint32_t a, uint32_t b)
+		{
+			return distanceTchebychev(_draw_list[a].id, cam_cid) < distanceTchebychev(_draw_list[b].id, cam_cid);
+		}
+	);
+	_cull_visible.assign(_draw_list.size(), 1);
+
+	const auto occlude = [&](glm::ivec2 cid)
+	{
+		const ChunkHandle handle = _chunks.find(cid);
+		if (!handle.valid())
+			return;
+		LoadedChunk const& loaded = _chunks[handle];
+		// At the level it is drawn at (as in the draw list), the majority vote of the LOD levels can lower the ground
+		// by up to a LOD voxel: only the cells below a multiple of its size are surely opaque
+		const int d = distanceTchebychev(cid, cam_cid);
+		const int lod = loaded.resident ? lodLevel(d) : std::max(1, lodLevel(d));
+		const int ground = loaded.heights.ground & ~((1 << lod) - 1);
+		glm::vec3 box_min, box_max;
+		chunkBox(cid, box_min, box_max);
+		_horizon.addOccluder({ box_min.x, box_min.z }, { box_max.x, box_max.z }, float(ground));
+	};
+
+	// Along a ray leaving the camera chunk, the ring of the chunks crossed never decreases: the chunks of a ring are
+	// tested against the horizon of the rings before it, then added to it
+	size_t i = 0;
+	for (int ring = 0; i < _horizon_order.size(); ++ring)
+	{
+		for (; i < _horizon_order.size() && distanceTchebychev(_draw_list[_horizon_order[i]].id, cam_cid) == ring; ++i)
+		{
+			const ChunkToDraw& td = _draw_list[_horizon_order[i]];
+			glm::vec3 box_min, box_max;
+			chunkBox(td.id, box_min, box_max);
+			// The LOD voxels can stand up to their size above the top of the full resolution ones
+			const int lod_size = 1 << td.lod;
+			const int top = (_chunks[td.handle].heights.top + lod_size - 1) / lod_size * lod_size;
+			if (_horizon.occluded({ box_min.x, box_min.z }, { box_max.x, box_max.z }, float(top)))
+				_cull_visible[_horizon_order[i]] = 0;
+		}
+		// The camera is above the chunk of the ring 0
+		if (ring == 0)
+			continue;
+		for (int u = -ring; u <= ring; ++u)
+		{
+			occlude(cam_cid + glm::ivec2(u, -ring));
+			occlude(cam_cid + glm::ivec2(u, ring));
+		}
+		for (int u = -ring + 1; u < ring; ++u)
+		{
+			occlude(cam_cid + glm::ivec2(-ring, u));
+			occlude(cam_cid + glm::ivec2(ring, u));
+		}
+	}
+
+	size_t n = 0;
+	for (size_t j = 0; j < _draw_list.size(); ++j)
+	{
+		if (_cull_visible[j])
+			_draw_list[n++] = _draw_list[j];
+	}
+	_draw_list.resize(n);
+}
+
+void World::setHorizonCulling(bool enable)
+{
+	_horizon_culling = enable;
+}
+
+bool World::horizonCulling()const
+{
+	return _horizon_culling;
+}
+
+void World::setCaveCulling(bool enable)
+{
+	_cave_culling = enable;
+}
+
+bool World::caveCulling()const
+{
+	return _cave_culling;
+}
+
+void World::setFrustumCulling(bool enable)
+{
+	_frustum_culling = enable;
+}
+
+bool World::frustumCulling()const
+{
+	return _frustum_culling;
+}
+
+World::CullStats const& World::cullStats()const
+{
+	return _cull_stats;
+}
+
+void World::readQueries()
+{
+	// From the oldest frame, the GPU finishes them in order
+	for (int i = 0; i < QueryFrames; ++i)
+	{
+		const int f = (_query_frame + i) % QueryFrames;
+		if (!_queries_pending[f])
+			continue;
+		GLuint available[2];
+		glGetQueryObjectuiv(_queries[f][0], GL_QUERY_RESULT_AVAILABLE, &available[0]);
+		glGetQueryObjectuiv(_queries[f][1], GL_QUERY_RESULT_AVAILABLE, &available[1]);
+		if (!available[0] || !available[1])
+			break;
+		GLuint64 time_ns, primitives;
+		glGetQueryObjectui64v(_queries[f][0], GL_QUERY_RESULT, &time_ns);
+		glGetQueryObjectui64v(_queries[f][1], GL_QUERY_RESULT, &primitives);
+		_render_stats.gpu_ms = double(time_ns) * 1e-6;
+		_render_stats.primitives = primitives;
+		_queries_pending[f] = false;
+	}
+}
+
+void World::draw(lib::Camera<float> const& cam)
+{
+	readQueries();
+	_render_stats.renderer = _renderer;
+	_render_stats.chunks = _draw_list.size();
+	_render_stats.sections = 0;
+	_render_stats.faces = 0;
+	_render_stats.lod_chunks = 0;
+	_render_stats.draw_calls = 0;
+	const auto start = std::chrono::steady_clock::now();
+
+	// A slot the GPU is still late on is not reused (glBeginQuery could wait for its results): the frame is not measured,
+	// the stats keep the ones of the last frame read
+	const bool measured = !_queries_pending[_query_frame];
+	if (measured)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, _queries[_query_frame][0]);
+		glBeginQuery(GL_PRIMITIVES_GENERATED, _queries[_query_frame][1]);
+	}
+
+	if (_renderer == Renderer::Mesh)
+		drawMeshes(cam);
+	else if (_renderer == Renderer::GeometryShader)
+		drawGeometryShader(cam);
+	// The LOD levels whatever the renderer, with the full resolution chunks for the faces renderer
+	drawFaces(cam, _renderer == Renderer::Faces);
+
+	if (measured)
+	{
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glEndQuery(GL_TIME_ELAPSED);
+		_queries_pending[_query_frame] = true;
+		_query_frame = (_query_frame + 1) % QueryFrames;
+	}
+	_render_stats.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+glm::mat4 World::recenteredView(lib::Camera<float> const& cam, glm::ivec2 const& cam_cid)const
+{
+	// The chunks are placed relative to the origin of cam_cid (base - recenter), moved back by the view to the world
+	const glm::vec3 recenter_v = { cam_cid.x * _chunk_size.x, 0, cam_cid.y * _chunk_size.z };
+	return cam.getMatrixV() * lib::translateMatrix<4, float>(recenter_v);
+}
+
+void World::drawGeometryShader(lib::Camera<float> const& cam)
+{
+	glBindVertexArray(a_ids_vao);
+
+	glm::ivec2 cam_cid = getChunkId(cam.getPosition());
+	const glm::mat4 V = recenteredView(cam, cam_cid);
+	glm::vec3 recenter_v = { cam_cid.x * _chunk_size.x, 0, cam_cid.y * _chunk_size.z};
+	glm::vec3 recentered_cam_pos = cam.getPosition() - recenter_v;
+
+	_vox_prog->use();
+	_vox_prog->setUniform("u_V", V);
+	_vox_prog->setUniform("u_P", cam.getMatrixP());
+	_vox_prog->setUniform("u_cam_pos", recentered_cam_pos);
+	_vox_prog->setUniform("u_indirect", _multi_draw);
+	const GLint u_draw = glGetUniformLocation(_vox_prog->id(), "u_draw");
+	// Nothing resident yet otherwise
+	if (_voxel_arena.handle())
+	{
+		_voxel_arena.bind(GL_SHADER_STORAGE_BUFFER, 0);
+		_voxel_arena.bind(GL_SHADER_STORAGE_BUFFER, 2);
+	}
+
+	_voxel_commands.clear();
+	_draw_voxels.clear();
+	for(ChunkToDraw & td : _draw_list)
+	{
+		if (td.lod != 0)
+			continue;
+		const glm::ivec2 recentered_cid = td.id - cam_cid;
+		const glm::ivec4 draw = { recentered_cid.x * _chunk_size.x, recentered_cid.y * _chunk_size.z, GLint(td.chunk->firstWord()), GLint(_chunks[td.handle].apron.firstWord()) };
+		if (!_multi_draw)
+			_vox_prog->setUniform(u_draw, draw);
+
+		// One draw per run of consecutive sections
+		const GLuint section_size = GLuint(td.chunk->sectionSize());
+		for (int s = 0; s < td.chunk->sectionCount();)
+		{
+			if (!(td.sections & (1u << s)))
+			{
+				++s;
+				continue;
+			}
+			int e = s + 1;
+			while (e < td.chunk->sectionCount() && (td.sections & (1u << e)))
+				++e;
+			_render_stats.sections += e - s;
+			if (_multi_draw)
+			{
+				_voxel_commands.push_back({ (e - s) * section_size, 1, s * section_size, 0 });
+				_draw_voxels.push_back(draw);
+			}
+			else
+			{
+				glDrawArrays(GL_POINTS, s * section_size, (e - s) * section_size);
+				++_render_stats.draw_calls;
+			}
+			s = e;
+		}
+	}
+
+	if (!_voxel_commands.empty())
+	{
+		// Orphaned every frame, as in drawFaces
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _draw_buffers[0]);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, _voxel_commands.size() * sizeof(BufferArena::DrawCommand), _voxel_commands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _draw_buffers[2]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, _draw_voxels.size() * sizeof(glm::ivec4), _draw_voxels.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, _draw_buffers[2]);
+
+		glMultiDrawArraysIndirect(GL_POINTS, nullptr, GLsizei(_voxel_commands.size()), 0);
+		++_render_stats.draw_calls;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	lib::ProgramDesc::useNone();
+	glBindVertexArray(0);
+
+}
+
+void World::drawMeshes(lib::Camera<float> const& cam)
+{
+	glBindVertexArray(a_ids_vao);
+
+	glm::ivec2 cam_cid = getChunkId(cam.getPosition());
+	const glm::mat4 V = recenteredView(cam, cam_cid);
+
+	_mesh_prog->use();
+	_mesh_prog->setUniform("u_V", V);
+	_mesh_prog->setUniform("u_P", cam.getMatrixP());
+	const GLint u_M = glGetUniformLocation(_mesh_prog->id(), "u_M");
+
+	for (ChunkToDraw& td : _draw_list)
+	{
+		if (td.lod != 0)
+			continue;
+		const ChunkMesh& mesh = _chunks[td.handle].mesh;
+		if (mesh.quadCount() == 0)
+			continue;
+
+		const glm::ivec2 recentered_cid = td.id - cam_cid;
+		glm::vec3 chunk_base = { recentered_cid.x * _chunk_size.x, 0, recentered_cid.y * _chunk_size.z };
+		glm::mat4 M = lib::translateMatrix<4, float>(chunk_base);
+		_mesh_prog->setUniform(u_M, M);
+
+		mesh.bind();
+		mesh.draw();
+		++_render_stats.draw_calls;
+	}
+
+	lib::ProgramDesc::useNone();
+	glBindVertexArray(0);
+}
+
+void World::drawFaces(lib::Camera<float> const& cam, bool full_res)
+{
+	glBindVertexArray(a_ids_vao);
+
+	glm::ivec2 cam_cid = getChunkId(cam.getPosition());
+	const glm::mat4 V = recenteredView(cam, cam_cid);
+	const glm::vec3 cam_pos = cam.getPosition();
+
+	_faces_prog->use();
+	_faces_prog->setUniform("u_V", V);
+	_faces_prog->setUniform("u_P", cam.getMatrixP());
+	_faces_prog->setUniform("u_indirect", _multi_draw);
+	const GLint u_chunk = glGetUniformLocation(_faces_prog->id(), "u_chunk");
+	// No face was uploaded yet otherwise
+	if (_face_arena.handle())
+		_face_arena.bind(GL_SHADER_STORAGE_BUFFER, 1);
+
+	_draw_commands.clear();
+	_draw_chunks.clear();
+	for (ChunkToDraw& td : _draw_list)
+	{
+		if (td.lod == 0 && !full_res)
+			continue;
+		const LoadedChunk& loaded = _chunks[td.handle];
+		const ChunkFaces& faces = td.lod ? loaded.lods[td.lod - 1] : loaded.faces;
+		if (td.lod)
+			++_render_stats.lod_chunks;
+		if (faces.faceCount() == 0 || !faces.uploaded())
+			continue;
+
+		// A + face can only be seen from a camera above the min of the box along its axis, a - face from below the max
+		glm::vec3 box_min, box_max;
+		chunkBox(td.id, box_min, box_max);
+		uint32_t face_mask = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (cam_pos[axis] > box_min[axis])
+				face_mask |= 1u << (2 * axis);
+			if (cam_pos[axis] < box_max[axis])
+				face_mask |= 1u << (2 * axis + 1);
+		}
+		for (int f = 0; f < ChunkFaces::Directions; ++f)
+		{
+			if (face_mask & (1u << f))
+				_render_stats.faces += faces.faceCount(f);
+		}
+
+		const glm::ivec2 recentered_cid = td.id - cam_cid;
+		const glm::vec4 chunk = { recentered_cid.x * _chunk_size.x, 0, recentered_cid.y * _chunk_size.z, float(1 << td.lod) };
+		if (_multi_draw)
+		{
+			const size_t commands = faces.appendDraws(face_mask, _draw_commands);
+			_draw_chunks.insert(_draw_chunks.end(), commands, chunk);
+		}
+		else
+		{
+			_faces_prog->setUniform(u_chunk, chunk);
+			_render_stats.draw_calls += faces.draw(face_mask);
+		}
+	}
+
+	if (!_draw_commands.empty())
+	{
+		// Orphaned every frame, the driver gives new storage instead of waiting for the draws of the previous frame
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _draw_buffers[0]);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, _draw_commands.size() * sizeof(ChunkFaces::DrawCommand), _draw_commands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _draw_buffers[1]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, _draw_chunks.size() * sizeof(glm::vec4), _draw_chunks.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _draw_buffers[1]);
+
+		glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr, GLsizei(_draw_commands.size()), 0);
+		++_render_stats.draw_calls;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	lib::ProgramDesc::useNone();
+	glBindVertexArray(0);
+}
@@ -3,8 +3,30 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <voxels/Chunk.h>
+#include <voxels/Mesher.h>
+#include <voxels/FaceStream.h>
+#include <voxels/ChunkApron.h>
+#include <voxels/Lod.h>
+#include <voxels/Light.h>
+#include <voxels/Connectivity.h>
+#include <voxels/JobSystem.h>
+#include <voxels/CompletionQueue.h>
+#include <voxels/Frustum.h>
+#include <voxels/Horizon.h>
+#include <voxels/ChunkMap.h>
+#include <voxels/BufferPool.h>
+#include <voxels/BufferArena.h>
+#include <voxels/RegionFile.h>
+#include <voxels/Noise.h>
+#include <voxels/TileCache.h>
+#include <voxels/Raycast.h>
 
 #include <lib/ProgramDesc.h>
 #include <lib/Transforms.h>
@@ -13,48 +35,336 @@
 #include <lib/ProgramDesc.h>
 
 #include <compare>
+#include <atomic>
 
 #include <iostream>
 
-template <>
-struct std::hash<glm::ivec2>
-{
-	_NODISCARD size_t operator()(glm::ivec2 const& cid) const noexcept;
-};
-
 class World
 {
 public:
 
-	class GridRayMarcher
+	enum class Renderer { GeometryShader, Mesh, Faces };
+
+	struct ColumnInfo
+	{
+		int dirt_start, dirt_height;
+	};
+
+	struct RenderStats
+	{
+		Renderer renderer;
+		size_t chunks;
+		// sections submitted by the geometry shader renderer, out of chunks * sectionCount
+		size_t sections;
+		// faces submitted by the faces renderer and for the LOD levels, after skipping the directions facing away from the camera
+		size_t faces;
+		// chunks drawn with a LOD level, from their downsampled faces
+		size_t lod_chunks;
+		// From GL queries of the latest frame done by the GPU (up to QueryFrames frames late, the frames issued while
+		// the GPU is later than that are not measured)
+		size_t primitives;
+		double gpu_ms;
+		// Main thread time to submit the draws of the frame, and the draw calls (a multi draw counts as one)
+		double cpu_ms;
+		size_t draw_calls;
+	};
+
+	// Limits of the chunk streaming per frame
+	struct StreamingBudget
+	{
+		// Main thread time and bytes for the uploads of a frame (at least one upload is done per frame)
+		double upload_ms = 4.0;
+		size_t upload_bytes = size_t(32) << 20;
+		// Chunks generated by the workers at once, 0 -> 2 per worker
+		size_t max_generating = 0;
+	};
+
+	struct StreamingStats
+	{
+		// Missing chunks in the load radius, not requested yet
+		size_t load_queue;
+		// Requested to the workers
+		size_t generating;
+		// Generated or meshed, waiting for the upload budget
+		size_t waiting_upload;
+		// Last frame
+		size_t uploaded_bytes;
+		double upload_ms;
+		// Last frame, main thread time to rebuild the aprons and light margins and submit the meshing
+		double seams_ms;
+	};
+
+	// Voxel of the world at position (world voxel coordinates) set to value
+	struct BlockEdit
 	{
-	public:
+		glm::ivec3 position;
+		Voxel value;
+	};
 
-		// 0 -> intersect horizontal lines
-		// 1 -> intersect vertical lines
-		bool _vertical;
+	// Of the edits applied by the last update
+	struct EditStats
+	{
+		size_t applied;
+		// On chunks being meshed, applied by a later update
+		size_t deferred;
+		// Out of the loaded chunks
+		size_t dropped;
+		size_t chunks;
+		// Sections whose connectivity was rebuilt
+		size_t sections;
+		// Chunks around the edited ones meshed (and lit) again, the ones within LightMargin::Margin columns of an edit
+		size_t neighbours;
+		double apply_ms;
+	};
 
-		glm::vec2 _pos;
-		glm::vec2 _dir_normalized, _dir;
+	struct CullStats
+	{
+		// chunks within the draw distance
+		size_t candidates;
+		size_t culled;
+		// of the chunks in the frustum, the ones with no section reachable from the camera
+		size_t cave_culled;
+		// of the remaining ones, the ones under the horizon of the terrain in front of them
+		size_t horizon_culled;
+	};
 
-		float tan_alpha;
+protected:
 
-	public:
+	// Declared before the chunks, which give their buffers back to it when destroyed
+	BufferPool _buffer_pool;
+	// The faces of all the chunks and of their LOD levels, drawn with a single multi draw (see drawFaces)
+	BufferArena _face_arena;
+	// The voxels and aprons of the resident chunks, read by voxel.geom with a single multi draw (see drawGeometryShader)
+	BufferArena _voxel_arena;
 
-		GridRayMarcher(glm::vec2 const& source, glm::vec2 const& dir);
+	struct LoadedChunk
+	{
+		Chunk chunk;
+		ChunkMesh mesh;
+		ChunkFaces faces;
+		// Last frame the chunk was within the load radius
+		uint64_t last_used;
+		// The region file has it
+		bool on_disk;
+		// Differs from the region file
+		bool modified;
+		// Facing planes of the neighbours
+		ChunkApron apron = {};
+		// Border faces culled thanks to the apron in the last meshing
+		size_t seam_faces = 0;
+		// The chunk or a neighbour changed since the full resolution mesh was built (or it was never built)
+		bool seams_dirty = false;
+		// In _seam_dirty_chunks
+		bool seams_queued = false;
+		// The full resolution mesh and faces were built, only within meshRadius() of the camera
+		bool has_full_res = false;
+		// A worker is meshing it (it must not be unloaded then)
+		bool meshing = false;
+		LodBuilder::LodFaces lods = {};
+		// The full resolution buffers (SSBO, mesh, faces, apron) are on the GPU, only near the camera
+		bool resident = false;
+		ChunkConnectivity connectivity = {};
+		// Sections reached by the visibility search of the frame cave_frame
+		uint32_t cave_sections = 0;
+		uint64_t cave_frame = 0;
+		ChunkHeights heights = {};
+		// Edited since the LOD levels were built, they are rebuilt with the next meshing
+		bool lods_dirty = false;
+		// Light of the cells of the chunk, kept to light the next edits incrementally (only near the camera, as the mesh)
+		std::shared_ptr<const ChunkLight> light;
+		// Edit batch (see _edit_batch) up to which light takes the edits into account
+		uint64_t light_batch = 0;
+		// Edited cells (world coordinates) within the light margin since the last lighting (only if it can be updated),
+		// and the batch of the first edit since then (0: none)
+		std::vector<glm::ivec3> light_seeds;
+		uint64_t seeds_batch = 0;
+		// Batch of the first edited cell of the lighting in flight (0: none), not in light either
+		uint64_t lighting_batch = 0;
+		// A neighbour was loaded or unloaded since the last lighting: the next one starts from scratch
+		bool full_light = true;
+	};
 
-		GridRayMarcher(glm::vec2 const& source, glm::vec2 const& dir, bool vertical);
+	ChunkMap<LoadedChunk> _chunks;
 
-		void firstStep();
+	// Unloaded chunks kept to be refilled by the workers
+	static constexpr size_t MaxPooledChunks = 64;
+	std::mutex _chunk_pool_mutex;
+	std::vector<Chunk> _chunk_pool;
 
-		void stepOne();
+	struct GeneratedChunk
+	{
+		glm::ivec2 id;
+		Chunk chunk;
+		bool from_disk;
+		LodBuilder::LodFaces lods;
+		ChunkConnectivity connectivity;
+		ChunkHeights heights;
+	};
 
-		glm::ivec2 getId()const;
+	struct MeshedChunk
+	{
+		ChunkHandle handle;
+		ChunkMesh mesh;
+		ChunkFaces faces;
+		size_t seam_faces;
+		// false: only the LOD levels were rebuilt, the chunk being beyond meshRadius()
+		bool full_res = true;
+		// Rebuilt after edits only
+		bool has_lods = false;
+		LodBuilder::LodFaces lods = {};
+		std::shared_ptr<const ChunkLight> light;
+		uint64_t light_batch = 0;
 	};
 
-protected:
+	// Chunks submitted to the workers, not yet in _chunks
+	std::unordered_set<glm::ivec2> _pending_chunks;
+	CompletionQueue<GeneratedChunk> _generated_chunks;
+	CompletionQueue<MeshedChunk> _remeshed_chunks;
+	// Done by the workers, uploaded as the budget of the frames allows
+	std::deque<GeneratedChunk> _ready_chunks;
+	std::deque<MeshedChunk> _ready_meshes;
 
-	std::unordered_map<glm::ivec2, Chunk> _chunks;
+	struct LoadRequest
+	{
+		// Lower first
+		float priority;
+		glm::ivec2 cid;
+	};
+
+	// Heap of the missing chunks, rebuilt each frame
+	std::vector<LoadRequest> _load_queue;
+	StreamingBudget _streaming_budget;
+	StreamingStats _streaming_stats;
+
+	struct UploadBudget
+	{
+		std::chrono::steady_clock::time_point start;
+		double max_ms;
+		size_t max_bytes;
+		size_t bytes;
+
+		bool available()const;
+	};
+
+	// Distance in chunks, doubled for the chunks behind the camera
+	float loadPriority(glm::ivec2 cid, glm::vec3 cam_pos, glm::vec3 cam_dir)const;
+
+	void requestChunk(glm::ivec2 cid);
+
+	void insertChunk(GeneratedChunk&& generated);
+	// Chunks to mesh again with a new apron, once their current meshing is done
+	std::vector<ChunkHandle> _seam_dirty_chunks;
+	// Reset first by ~World: the jobs use members declared after it
+	std::unique_ptr<JobSystem> _jobs;
+
+	// nullptr -> the chunks are not saved
+	std::unique_ptr<RegionStore> _regions;
+	// Unloaded chunks being written, they are not loaded again before that is done
+	std::unordered_set<glm::ivec2> _saving_chunks;
+	CompletionQueue<glm::ivec2> _saved_chunks;
+	// A single thread writing the region files
+	std::unique_ptr<JobSystem> _save_jobs;
+
+	std::atomic<size_t> _disk_loads;
+	std::atomic<uint64_t> _disk_load_ns;
+	std::atomic<size_t> _generations;
+	std::atomic<uint64_t> _generation_ns;
+
+	size_t _total_generated_chunks;
+	size_t _total_unloaded_chunks;
+	uint64_t _frame;
+
+	// Chunks between _load_radius and _load_radius + _unload_margin are kept while the memory budget allows it,
+	// the ones further away are always unloaded
+	int _unload_margin;
+	size_t _memory_budget;
+	std::vector<std::pair<uint64_t, ChunkHandle>> _eviction_candidates;
+
+	// Thread safe
+	Chunk acquireChunk();
+
+	void releaseChunk(Chunk&& chunk);
+
+	static size_t hostMemory(LoadedChunk const& loaded);
+
+	static size_t deviceMemory(LoadedChunk const& loaded);
+
+	void unloadChunk(ChunkHandle handle);
+
+	// Queued for updateSeams if it is not yet
+	void queueSeams(ChunkHandle handle);
+
+	// light_seeds: the edited cells (world coordinates) to light again incrementally, none: a neighbour was loaded
+	// or unloaded, the light is built again from scratch
+	void markSeamsDirty(ChunkHandle handle, std::span<const glm::ivec3> light_seeds = {});
+
+	// Marks the 8 chunks around handle whose light margin (or apron) overlaps the columns [lo, hi] of the chunk,
+	// returns their number
+	size_t markNeighboursDirty(ChunkHandle handle, glm::ivec2 const& lo, glm::ivec2 const& hi, std::span<const glm::ivec3> light_seeds = {});
+
+	// The light of the chunk can be updated from the edited cells: the lights it starts from (of the chunk and of
+	// its 8 neighbours) take the same edits into account around it. The light is built from scratch otherwise.
+	bool canUpdateLight(ChunkHandle handle)const;
+
+	// Rebuilds the aprons and the light margins of the chunks marked dirty within meshRadius() and submits their meshing
+	// (and lighting) to the workers. The ones further away stay dirty, only their LOD levels are rebuilt if edited.
+	void updateSeams(glm::ivec2 cam_cid);
+
+	// Chunk distance up to which the full resolution mesh, faces and light are built: one more than the resident chunks,
+	// so that they are meshed before they are drawn at full resolution
+	int meshRadius()const;
+
+	// Full resolution for all the loaded chunks, for comparison
+	bool _mesh_all;
+
+	// Queued by setBlock(s), applied by update
+	std::vector<BlockEdit> _block_edits;
+	EditStats _edit_stats;
+	// Number of the updates that edited the chunks, for the light of the chunks (see LoadedChunk::light_batch)
+	uint64_t _edit_batch;
+
+	// Applies the queued edits chunk by chunk: only the edited chunk and the neighbours within the light margin of an edit
+	// are meshed and lit again, the connectivity of the edited sections only is rebuilt, and only the modified words of the
+	// SSBO are uploaded (see Chunk::updateSSBO). The edits of a chunk being meshed stay queued.
+	void applyEdits();
+
+	// Uploads the full resolution buffers of the chunks entering the LOD 0 distance (+1), frees the ones of the chunks leaving it
+	void updateResidency(glm::ivec2 cam_cid, UploadBudget& budget);
+
+	// Least recently used first
+	void evictChunks(glm::ivec2 cam_cid);
+
+	std::vector<Property> _properties;
+	OpaqueTable _opaque;
+	EmissionTable _emission;
+	GreedyMesher _mesher;
+	GradientNoise _noise;
+	// Generated tile by tile from _noise, read by fillChunk and the queries of the columns from any thread
+	mutable TileCache<ColumnInfo> _column_cache;
+	std::atomic<uint64_t> _meshing_ns;
+	std::atomic<size_t> _meshed_chunks;
+	FaceBuilder _face_builder;
+	LodBuilder _lod_builder;
+	LightBuilder _light_builder;
+	// Chunk distance up to which the level l is drawn, the last level is used beyond
+	std::array<int, LodBuilder::Levels> _lod_distances;
+	std::atomic<uint64_t> _face_building_ns;
+	std::atomic<uint64_t> _lighting_ns;
+	// Of the lightings after edits, also counted in _lighting_ns
+	std::atomic<uint64_t> _edit_lighting_ns;
+	std::atomic<size_t> _edit_lit_chunks;
+	std::atomic<size_t> _incremental_lit_chunks;
+
+	Renderer _renderer;
+	RenderStats _render_stats;
+	// Ring buffer of the queries of the last frames, read once the GPU is done with them, without waiting
+	static constexpr int QueryFrames = 3;
+	// time elapsed, primitives generated
+	GLuint _queries[QueryFrames][2];
+	// Issued and not read yet
+	bool _queries_pending[QueryFrames];
+	// Slot of the queries of the next frame, the oldest one
+	int _query_frame;
 
 	glm::ivec3 _chunk_size;
 
@@ -64,32 +374,246 @@ protected:
 	struct ChunkToDraw
 	{
 		Chunk* chunk;
+		ChunkHandle handle;
 		glm::ivec2 id;
 		float distance;
+		// bit s set -> the section s has to be drawn
+		uint32_t sections;
+		// 0: full resolution, l > 0: faces of the LOD level l
+		int lod;
 	};
 
 	std::vector<ChunkToDraw> _draw_list;
 
+	bool _frustum_culling;
+	AABBList _cull_boxes;
+	std::vector<uint8_t> _cull_visible;
+	CullStats _cull_stats;
+
+	void chunkBox(glm::ivec2 cid, glm::vec3& box_min, glm::vec3& box_max)const;
+
+	bool isOpaque(Voxel v)const;
+
+	bool sectionIsUniformOpaque(Chunk const& chunk, int s)const;
+
+	// Skips the empty sections and the uniform opaque ones surrounded by uniform opaque sections
+	uint32_t sectionsToDraw(ChunkHandle handle)const;
+
+	struct CaveStep
+	{
+		ChunkHandle handle;
+		glm::ivec2 cid;
+		int section;
+		// Face of the section it was entered through, -1 for the section of the camera
+		int entered;
+		// Faces crossed since the camera (bit f), the search never goes back against one of them
+		uint32_t directions;
+	};
+
+	bool _cave_culling;
+	uint64_t _cave_frame;
+	std::vector<CaveStep> _cave_queue;
+
+	// Breadth first search of the sections seen from the camera section, through the faces that the connectivity
+	// of the sections links (and in the frustum if frustum culling is on), marks them in cave_sections.
+	// Returns false if the camera is not in a loaded chunk (nothing is culled then).
+	bool caveCull(lib::Camera<float> const& cam);
+
+	bool _horizon_culling;
+	HorizonBuffer _horizon;
+	// Indices of the draw list, by ring of chunks around the camera
+	std::vector<uint32_t> _horizon_order;
+
+	// Removes the chunks of the draw list whose top is under the horizon of the chunks of the rings in front of them
+	// (all the loaded chunks of these rings are occluders, in the frustum or not)
+	void horizonCull(lib::Camera<float> const& cam);
+
 	int _load_radius, _draw_distance;
 
 	std::shared_ptr<lib::ProgramDesc> _vox_prog;
+	std::shared_ptr<lib::ProgramDesc> _mesh_prog;
+	std::shared_ptr<lib::ProgramDesc> _faces_prog;
+
+	void readQueries();
+
+	// View matrix of the chunks placed relative to the chunk of the camera cam_cid (their model offset is their id - cam_cid)
+	glm::mat4 recenteredView(lib::Camera<float> const& cam, glm::ivec2 const& cam_cid)const;
+
+	void drawGeometryShader(lib::Camera<float> const& cam);
+
+	void drawMeshes(lib::Camera<float> const& cam);
+
+	bool _multi_draw;
+	// Commands of the multi draw of the faces and their chunk (origin, voxel size), read with gl_DrawID
+	std::vector<ChunkFaces::DrawCommand> _draw_commands;
+	std::vector<glm::vec4> _draw_chunks;
+	// Commands of the multi draw of the voxels and their chunk (origin x and z, first words of its voxels and apron)
+	std::vector<BufferArena::DrawCommand> _voxel_commands;
+	std::vector<glm::ivec4> _draw_voxels;
+	// indirect commands, chunks of the faces commands, chunks of the voxels commands
+	GLuint _draw_buffers[3];
+
+	// The faces of the LOD levels, and of the full resolution chunks if full_res
+	void drawFaces(lib::Camera<float> const& cam, bool full_res);
 
 public:
 
-	World(glm::ivec3 chunk_size = { 32, 256, 32 });
+	World(glm::ivec3 chunk_size = { 32, 256, 32 }, unsigned int n_workers = 0);
 
-	struct ColumnInfo
-	{
-		int dirt_start, dirt_height;
-	};
+	~World();
+
+	// Must be set before the first update, the workers read them
+	void setProperties(std::vector<Property> const& properties);
+
+	// Loads and saves the chunks in the region files of directory, must be set before the first update
+	void setSaveDirectory(std::filesystem::path const& directory);
+
+	// Writes the loaded chunks that are not saved yet, and waits for all the pending saves
+	void saveAll();
 
+protected:
+
+	ColumnInfo columnInfoFromNoise(float p)const;
+
+	// Columns [first, first + size), res[i * size.y + j] for the column first + (i, j), from the noise
+	void generateColumns(glm::ivec2 first, glm::ivec2 size, ColumnInfo* res)const;
+
+public:
+
+	// Horizontal scale of the terrain noise (noise units per column)
+	static constexpr float NoiseScale = 0.05f;
+
+	// cid: world column id
 	ColumnInfo generateColumnInfo(glm::ivec2 cid)const;
 
-	void fillChunk(glm::ivec2 cid);
+	// All the columns of the chunk cid at once, res[i * chunk_size.z + j] for the column (i, j)
+	void generateColumnInfos(glm::ivec2 cid, ColumnInfo* res)const;
+
+	// Same as generateColumnInfo and generateColumnInfos, read from the cache of the columns, thread safe
+	ColumnInfo columnInfo(glm::ivec2 column)const;
+
+	void columnInfos(glm::ivec2 cid, ColumnInfo* res)const;
+
+	// Height of the first air voxel of the column
+	int terrainHeight(glm::ivec2 column)const;
+
+	TileCache<ColumnInfo> const& columnCache()const;
+
+	// Thread safe, called from the workers
+	void fillChunk(Chunk& chunk, glm::ivec2 cid)const;
 
 	glm::ivec2 getChunkId(glm::vec3 wpos)const;
 
-	void update(glm::vec3 cam_pos);
+	// First non empty voxel along the ray in the loaded chunks.
+	// Can be called from any thread, but not during update (which loads and unloads the chunks).
+	RayHit raycast(Ray const& ray)const;
+
+	// Same as n calls to raycast, reusing the chunk lookups between consecutive rays
+	void raycast(Ray const* rays, size_t n, RayHit* hits)const;
+
+	// Requests the missing chunks to the workers, closest and in front of the camera first,
+	// and uploads the ones they finished within the streaming budget
+	void update(glm::vec3 cam_pos, glm::vec3 cam_dir = { 0, 0, 0 });
+
+	// The edits are queued and applied together by the next update. Thread unsafe, call them from the thread of update.
+	void setBlock(glm::ivec3 const& position, Voxel value);
+
+	void setBlocks(std::span<const BlockEdit> edits);
+
+	EditStats const& editStats()const;
+
+	void setStreamingBudget(StreamingBudget const& budget);
+
+	StreamingBudget const& streamingBudget()const;
+
+	StreamingStats const& streamingStats()const;
+
+	size_t loadedChunks()const;
+
+	// Loaded chunks with their full resolution mesh and faces (the others only have their LOD levels)
+	size_t fullResChunks()const;
+
+	size_t pendingChunks()const;
+
+	// Number of chunks generated and uploaded since the creation of the world
+	size_t totalGeneratedChunks()const;
+
+	size_t totalUnloadedChunks()const;
+
+	// Average time for a worker to get the voxels of a chunk, from the region files or from fillChunk
+	double meanDiskLoadMs()const;
+
+	double meanGenerationMs()const;
+
+	size_t totalDiskLoads()const;
+
+	// Bytes used by the loaded chunks (voxels and meshes)
+	size_t chunksHostMemory()const;
+
+	size_t chunksDeviceMemory()const;
+
+	// Host + device bytes the loaded chunks can use before the least recently used ones are unloaded
+	void setMemoryBudget(size_t bytes);
+
+	size_t memoryBudget()const;
+
+	BufferPool const& bufferPool()const;
+
+	BufferArena const& faceArena()const;
+
+	BufferArena const& voxelArena()const;
+
+	// Load radius and draw distance, in chunks
+	void setViewDistance(int chunks);
+
+	int viewDistance()const;
+
+	// distances[l]: chunk distance up to which the LOD level l is used (0: full resolution)
+	void setLodDistances(std::array<int, LodBuilder::Levels> const& distances);
+
+	int lodLevel(int chunk_distance)const;
+
+	// Faces by default, the only one drawing the light (see FaceStream.h), the others are kept for comparison
+	void setRenderer(Renderer renderer);
+
+	Renderer renderer()const;
+
+	RenderStats const& renderStats()const;
+
+	// true: the faces and the voxels of the geometry shader are drawn with a single glMultiDrawArraysIndirect each, false: with draws per chunk
+	void setMultiDraw(bool enable);
+
+	bool multiDraw()const;
+
+	// true: the full resolution mesh, faces and light are built for all the loaded chunks, false: within meshRadius() only
+	void setMeshAllChunks(bool enable);
+
+	bool meshAllChunks()const;
+
+	// Chunks meshed at full resolution so far, and the worker time they took (meshing, lighting and faces)
+	size_t totalMeshedChunks()const;
+
+	double totalMeshingMs()const;
+
+	// Average time to mesh a chunk on a worker
+	double meanMeshingMs()const;
+
+	// Average time to build the faces of a chunk on a worker
+	double meanFaceBuildingMs()const;
+
+	// Average time to propagate the light through a chunk and its margin on a worker
+	double meanLightingMs()const;
+
+	// Worker time spent lighting the chunks again after edits so far (the edited ones and their neighbours),
+	// the number of these lightings, and of the ones done incrementally (the others being built from scratch)
+	double editLightingMs()const;
+
+	size_t editLitChunks()const;
+
+	size_t incrementalLitChunks()const;
+
+	// Border faces of the loaded chunks culled against their neighbours
+	size_t seamFacesRemoved()const;
 
 	void draw(lib::Camera<float> const& cam);
 
@@ -97,4 +621,20 @@ public:
 
 	void buildDrawList(lib::Camera<float> const& cam);
 
+	void setFrustumCulling(bool enable);
+
+	bool frustumCulling()const;
+
+	// Skips the chunk sections that can not be seen from the camera section through the open cells (caves, mountains)
+	void setCaveCulling(bool enable);
+
+	bool caveCulling()const;
+
+	// Skips the chunks hidden behind the terrain of the chunks closer to the camera (hills, or the ground above the camera)
+	void setHorizonCulling(bool enable);
+
+	bool horizonCulling()const;
+
+	CullStats const& cullStats()const;
+
 };
\ No newline at end of file